@@ -0,0 +1,390 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+/**
+ * @file  alloc_trace.cpp
+ *
+ * Code for the binary trace of memory allocation events.  It does not
+ * allocate memory with <code>operator new</code> when recording events,
+ * so it can be used in the implementation of <code>operator new</code>.
+ * The current code requires a C++11-compliant compiler.
+ *
+ * @date  2026-10-16
+ */
+
+#include "alloc_trace.h"        // nvwa::alloc_event/trace_alloc_event
+#include <atomic>               // std::atomic
+#include <condition_variable>   // std::condition_variable
+#include <mutex>                // std::mutex/std::lock_guard/unique_lock
+#include <algorithm>            // std::stable_sort
+#include <new>                  // placement new
+#include <thread>               // std::thread
+#include <stdio.h>              // FILE/fopen/fwrite/fclose
+#include <stdlib.h>             // malloc/free
+#include <string.h>             // memcmp/memcpy
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+#include "fast_mutex.h"         // nvwa::fast_mutex/fast_mutex_autolock
+
+NVWA_NAMESPACE_BEGIN
+
+static_assert(sizeof(alloc_event) == 32, "Unexpected size of alloc_event");
+
+namespace {
+
+/**
+ * Single-producer single-consumer ring buffer of events.  The owning
+ * thread advances \a head, and the writer thread advances \a tail.
+ * The buffer is freed by the writer thread after the owning thread
+ * exits and the events are written.
+ */
+struct alloc_trace_buffer {
+    alloc_trace_buffer* next;       ///< Next buffer in the list
+    size_t              capacity;   ///< Number of events; a power of two
+    uint16_t            thread;     ///< Index of the owning thread
+    std::atomic<bool>   orphaned;   ///< Whether the owner has exited
+    char                pad1[64];   ///< Padding against false sharing
+    std::atomic<size_t> head;       ///< Count of events recorded
+    char                pad2[64];   ///< Padding against false sharing
+    std::atomic<size_t> tail;       ///< Count of events written
+    char                pad3[64];   ///< Padding against false sharing
+    alloc_event         events[1];  ///< The events
+};
+
+/**
+ * Owner of the buffer of a thread.  Its destructor hands the buffer
+ * over to the writer thread.
+ */
+struct alloc_trace_buffer_owner {
+    alloc_trace_buffer* buffer;
+    ~alloc_trace_buffer_owner();
+};
+
+std::atomic<bool> trace_enabled(false);
+std::atomic<size_t> trace_drop_cnt(0);
+size_t trace_buffer_size = 8192;
+
+/**
+ * The mutex guard to protect the list of buffers.  It is acquired by
+ * a recording thread only when its buffer is created.
+ */
+fast_mutex buffer_list_lock;
+alloc_trace_buffer* buffer_list = nullptr;
+uint16_t next_thread_index = 0;
+
+/**
+ * The mutex to protect the trace file and the writer thread.
+ */
+const char trace_magic[8] = {'N', 'V', 'W', 'A', 'A', 'T', 'R', 'C'};
+const uint32_t trace_version = 1;
+
+std::mutex trace_mtx;
+std::condition_variable trace_cv;
+std::thread trace_writer;
+FILE* trace_fp = nullptr;
+bool trace_stopping = false;
+std::chrono::milliseconds trace_interval;
+
+thread_local alloc_trace_buffer* thread_buffer = nullptr;
+thread_local bool thread_exiting = false;
+thread_local alloc_trace_buffer_owner thread_buffer_owner;
+
+alloc_trace_buffer_owner::~alloc_trace_buffer_owner()
+{
+    thread_exiting = true;
+    thread_buffer = nullptr;
+    if (buffer != nullptr) {
+        buffer->orphaned.store(true, std::memory_order_release);
+    }
+}
+
+/**
+ * Creates the buffer of the current thread.
+ *
+ * @return  pointer to the buffer; or \c nullptr if memory is
+ *          insufficient
+ */
+alloc_trace_buffer* create_buffer()
+{
+    size_t capacity = 1;
+    while (capacity < trace_buffer_size) {
+        capacity *= 2;
+    }
+    void* mem = malloc(sizeof(alloc_trace_buffer) +
+                       (capacity - 1) * sizeof(alloc_event));
+    if (mem == nullptr) {
+        return nullptr;
+    }
+    auto buffer = new (mem) alloc_trace_buffer;
+    buffer->capacity = capacity;
+    buffer->orphaned.store(false, std::memory_order_relaxed);
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->tail.store(0, std::memory_order_relaxed);
+    {
+        fast_mutex_autolock lock(buffer_list_lock);
+        buffer->thread = next_thread_index++;
+        buffer->next = buffer_list;
+        buffer_list = buffer;
+    }
+    thread_buffer = buffer;
+    thread_buffer_owner.buffer = buffer;
+    return buffer;
+}
+
+/**
+ * Writes the recorded events in all buffers to the trace file, and
+ * frees the buffers of exited threads.  The caller should hold
+ * #trace_mtx.
+ *
+ * @param discard  whether to discard the events instead of writing them
+ */
+void drain_buffers(bool discard = false)
+{
+    fast_mutex_autolock lock(buffer_list_lock);
+    alloc_trace_buffer** link = &buffer_list;
+    while (alloc_trace_buffer* buffer = *link) {
+        bool orphaned = buffer->orphaned.load(std::memory_order_acquire);
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t tail = buffer->tail.load(std::memory_order_relaxed);
+        if (!discard && trace_fp != nullptr && head != tail) {
+            size_t mask = buffer->capacity - 1;
+            size_t first = tail & mask;
+            size_t count = head - tail;
+            size_t count1 = buffer->capacity - first;
+            if (count1 > count) {
+                count1 = count;
+            }
+            fwrite(&buffer->events[first], sizeof(alloc_event), count1,
+                   trace_fp);
+            fwrite(&buffer->events[0], sizeof(alloc_event),
+                   count - count1, trace_fp);
+        }
+        buffer->tail.store(head, std::memory_order_release);
+        if (orphaned) {
+            *link = buffer->next;
+            buffer->~alloc_trace_buffer();
+            free(buffer);
+        } else {
+            link = &buffer->next;
+        }
+    }
+}
+
+/**
+ * Loop of the writer thread.
+ */
+void write_events()
+{
+    std::unique_lock<std::mutex> lock(trace_mtx);
+    FILE* fp = trace_fp;
+    while (!trace_stopping) {
+        trace_cv.wait_for(lock, trace_interval);
+        drain_buffers();
+
+        // Do not block start_alloc_trace/stop_alloc_trace on the I/O.
+        // The file is written only in this thread until it is joined.
+        lock.unlock();
+        fflush(fp);
+        lock.lock();
+    }
+}
+
+/**
+ * Stopper of the trace on program exit, so that the remaining events
+ * are written and the writer thread is joined.
+ */
+struct alloc_trace_stopper {
+    ~alloc_trace_stopper()
+    {
+        stop_alloc_trace();
+    }
+} trace_stopper;
+
+} /* unnamed namespace */
+
+/**
+ * Starts tracing allocation events to a file.  Threads get their own
+ * buffers when they first record an event.  Events are dropped (and
+ * counted) if a buffer is full when an event is recorded.
+ *
+ * @param path         path of the trace file, which is truncated
+ * @param buffer_size  number of events in the buffer of each thread;
+ *                     rounded up to a power of two
+ * @param interval     interval at which the buffers are written out
+ * @return             \c true if tracing is started; \c false if the
+ *                     file cannot be opened or tracing is running
+ */
+bool start_alloc_trace(const char* path, size_t buffer_size,
+                       std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> guard(trace_mtx);
+    if (trace_fp != nullptr) {
+        return false;
+    }
+    FILE* fp = fopen(path, "wb");
+    if (fp == nullptr) {
+        return false;
+    }
+    uint32_t header[2] = {trace_version, sizeof(alloc_event)};
+    fwrite(trace_magic, sizeof trace_magic, 1, fp);
+    fwrite(header, sizeof header, 1, fp);
+
+    // Events left after the last stop belong to the last trace
+    drain_buffers(true);
+    trace_fp = fp;
+    trace_buffer_size = buffer_size == 0 ? 1 : buffer_size;
+    trace_interval = interval;
+    trace_stopping = false;
+    trace_writer = std::thread(write_events);
+    trace_enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Stops tracing allocation events, and closes the trace file after
+ * writing out the recorded events.
+ */
+void stop_alloc_trace()
+{
+    std::thread writer;
+    {
+        std::lock_guard<std::mutex> guard(trace_mtx);
+        if (trace_fp == nullptr) {
+            return;
+        }
+        trace_enabled.store(false, std::memory_order_relaxed);
+        trace_stopping = true;
+        writer = std::move(trace_writer);
+    }
+    trace_cv.notify_one();
+    writer.join();
+
+    std::lock_guard<std::mutex> guard(trace_mtx);
+    drain_buffers();
+    fclose(trace_fp);
+    trace_fp = nullptr;
+}
+
+/**
+ * Records an allocation event, if tracing is started.  It is called by
+ * the memory tracers, but can also be called directly.  It is
+ * lock-free except for the first call in a thread.
+ *
+ * @param type  type of the event
+ * @param ptr   pointer to the user memory
+ * @param size  size of the memory block
+ * @param id    ID of the allocation context or stack trace; or \c 0
+ */
+void trace_alloc_event(alloc_event_type type, const void* ptr,
+                       size_t size, uint32_t id)
+{
+    if (!trace_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    alloc_trace_buffer* buffer = thread_buffer;
+    if (buffer == nullptr) {
+        if (thread_exiting || (buffer = create_buffer()) == nullptr) {
+            trace_drop_cnt.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    size_t head = buffer->head.load(std::memory_order_relaxed);
+    size_t tail = buffer->tail.load(std::memory_order_acquire);
+    if (head - tail == buffer->capacity) {
+        trace_drop_cnt.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    alloc_event& event = buffer->events[head & (buffer->capacity - 1)];
+    event.timestamp = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    event.address = reinterpret_cast<uintptr_t>(ptr);
+    event.size = size;
+    event.id = id;
+    event.thread = buffer->thread;
+    event.type = type;
+    event.reserved = 0;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * Gets the number of events dropped because the buffers were full.
+ *
+ * @return  count of dropped events
+ */
+size_t get_alloc_trace_drop_count()
+{
+    return trace_drop_cnt.load(std::memory_order_relaxed);
+}
+
+/**
+ * Reads the events in a trace file, and sorts them by the timestamp.
+ * Records larger than alloc_event, as may be written by later versions
+ * of the format, have their extra bytes skipped.  An incomplete record
+ * at the end of the file, as left by a crashed process, is ignored.
+ *
+ * @param path         path of the trace file
+ * @param[out] events  the events read from the file
+ * @return             \c true if the file is read successfully;
+ *                     \c false if it cannot be opened or its header is
+ *                     invalid
+ */
+bool read_alloc_trace(const char* path, std::vector<alloc_event>& events)
+{
+    events.clear();
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    char magic[sizeof trace_magic];
+    uint32_t header[2];
+    if (fread(magic, sizeof magic, 1, fp) != 1 ||
+            fread(header, sizeof header, 1, fp) != 1 ||
+            memcmp(magic, trace_magic, sizeof magic) != 0 ||
+            header[0] != trace_version ||
+            header[1] < sizeof(alloc_event)) {
+        fclose(fp);
+        return false;
+    }
+    std::vector<char> record(header[1]);
+    alloc_event event;
+    while (fread(record.data(), record.size(), 1, fp) == 1) {
+        memcpy(&event, record.data(), sizeof event);
+        events.push_back(event);
+    }
+    fclose(fp);
+
+    // Keep the order of events with the same timestamp
+    std::stable_sort(events.begin(), events.end(),
+                     [](const alloc_event& lhs, const alloc_event& rhs) {
+                         return lhs.timestamp < rhs.timestamp;
+                     });
+    return true;
+}
+
+NVWA_NAMESPACE_END
@@ -0,0 +1,88 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+/**
+ * @file  alloc_trace.h
+ *
+ * Header file for a compact binary trace of memory allocation events.
+ * Events are recorded in per-thread lock-free ring buffers, and a
+ * background thread writes them to a file.  The current code requires
+ * a C++11-compliant compiler.
+ *
+ * @date  2026-10-16
+ */
+
+#ifndef NVWA_ALLOC_TRACE_H
+#define NVWA_ALLOC_TRACE_H
+
+#include <chrono>               // std::chrono::milliseconds
+#include <vector>               // std::vector
+#include <stddef.h>             // size_t
+#include <stdint.h>             // uint*_t
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+
+NVWA_NAMESPACE_BEGIN
+
+/** Type of an allocation event. */
+enum alloc_event_type : uint8_t {
+    alloc_event_alloc = 1,      ///< Memory is allocated
+    alloc_event_free  = 2       ///< Memory is deallocated
+};
+
+/**
+ * Record of an allocation event, as written to the trace file.  The
+ * file starts with a header of 16 bytes: the magic string
+ * <code>"NVWAATRC"</code>, the format version (1), and the size of an
+ * event record (32), the latter two as 32-bit integers in native byte
+ * order.  The records follow.  Records from different threads are not
+ * ordered by time in the file, so a replaying tool should sort them by
+ * the timestamp first, as read_alloc_trace does.
+ */
+struct alloc_event {
+    uint64_t timestamp;         ///< Time in nanoseconds (steady clock)
+    uint64_t address;           ///< Address of the user memory
+    uint64_t size;              ///< Size of the memory block
+    uint32_t id;                ///< Context or stack trace ID; or \c 0
+    uint16_t thread;            ///< Index of the recording thread
+    uint8_t  type;              ///< Type of the event (alloc_event_type)
+    uint8_t  reserved;          ///< Reserved; always \c 0
+};
+
+bool start_alloc_trace(const char* path,
+                       size_t buffer_size = 8192,
+                       std::chrono::milliseconds interval =
+                           std::chrono::milliseconds(10));
+void stop_alloc_trace();
+void trace_alloc_event(alloc_event_type type, const void* ptr,
+                       size_t size, uint32_t id);
+size_t get_alloc_trace_drop_count();
+bool read_alloc_trace(const char* path, std::vector<alloc_event>& events);
+
+NVWA_NAMESPACE_END
+
+#endif // NVWA_ALLOC_TRACE_H
@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2013-2023 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2013-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,7 +31,7 @@
  *
  * Modern C++ feature detection macros and workarounds.
  *
- * @date  2023-08-19
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_CXX_FEATURES_H
@@ -104,6 +104,17 @@
 
 /* Feature checks */
 
+#if !defined(HAVE_CXX11_ALIGNAS)
+#if NVWA_CXX11_MODE && \
+    (__has_feature(cxx_alignas) || \
+     (defined(_MSC_VER) && _MSC_VER >= 1900) || \
+     (defined(__GNUC__) && __GNUC__ * 100 + __GNUC_MINOR__ >= 408))
+#define HAVE_CXX11_ALIGNAS 1
+#else
+#define HAVE_CXX11_ALIGNAS 0
+#endif
+#endif
+
 #if !defined(HAVE_CXX11_ATOMIC)
 #if NVWA_CXX11_MODE && \
     ((__has_include(<atomic>) && !defined(__MINGW32__)) || \
@@ -351,6 +362,17 @@
 #endif
 #endif
 
+#if !defined(HAVE_CXX17_MEMORY_RESOURCE)
+#if NVWA_USES_CXX17 && \
+    ((__has_include(<memory_resource>) && !NVWA_USES_CRIPPLED_CLANG) || \
+     (defined(_MSC_VER) && _MSC_VER >= 1913) || \
+     (defined(__GNUC__) && __GNUC__ * 100 + __GNUC_MINOR__ >= 900))
+#define HAVE_CXX17_MEMORY_RESOURCE 1
+#else
+#define HAVE_CXX17_MEMORY_RESOURCE 0
+#endif
+#endif
+
 #if !defined(HAVE_CXX17_OPTIONAL)
 #if NVWA_USES_CXX17 && \
     ((__has_include(<optional>) && !NVWA_USES_CRIPPLED_CLANG) || \
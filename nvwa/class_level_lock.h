@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2021 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,7 +31,7 @@
  *
  * In essence Loki ClassLevelLockable re-engineered to use a fast_mutex class.
  *
- * @date  2021-08-06
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_CLASS_LEVEL_LOCK_H
@@ -47,13 +47,21 @@ NVWA_NAMESPACE_BEGIN
      * Helper class for class-level locking.  This is the
      * single-threaded implementation.
      */
-    template <class _Host, bool _RealLock = false>
+    template <class _Host, bool _RealLock = false,
+              class _Mutex = fast_mutex>
     class class_level_lock {
     public:
         /** Type that provides locking/unlocking semantics. */
         class lock {
         public:
-            lock() = default;
+            lock() {}
+            explicit lock(bool& contended) { contended = false; }
+        };
+
+        /** Type that provides shared locking/unlocking semantics. */
+        class shared_lock {
+        public:
+            shared_lock() {}
         };
 
         typedef _Host volatile_type;
@@ -64,11 +72,15 @@ NVWA_NAMESPACE_BEGIN
      * implementation.  The main departure from Loki ClassLevelLockable
      * is that there is an additional template parameter which can make
      * the lock not %lock at all even in multi-threaded environments.
-     * See static_mem_pool.h for real usage.
+     * See static_mem_pool.h for real usage.  The mutex type can be
+     * changed to a reader-writer mutex (like fast_shared_mutex or
+     * \c std::shared_mutex) so that shared_lock can be used for
+     * read-only access.
      */
-    template <class _Host, bool _RealLock = true>
+    template <class _Host, bool _RealLock = true,
+              class _Mutex = fast_mutex>
     class class_level_lock {
-        static fast_mutex _S_mtx;
+        static _Mutex _S_mtx;
 
     public:
         // The C++ 1998 Standard required the use of `friend' here, but
@@ -76,17 +88,54 @@ NVWA_NAMESPACE_BEGIN
         // changed.  It is still used here for compatibility with older
         // compilers.
         class lock;
+        class shared_lock;
         friend class lock;
+        friend class shared_lock;
 
         /** Type that provides locking/unlocking semantics. */
         class lock {
         public:
+#   if _FAST_MUTEX_PROFILE
+            lock(const char* file = _FAST_MUTEX_CALLER_FILE,
+                 int line = _FAST_MUTEX_CALLER_LINE)
+            {
+                if (_RealLock) {
+                    fast_mutex_impl::lock_at(_S_mtx, file, line);
+                }
+            }
+            explicit lock(bool& contended,
+                          const char* file = _FAST_MUTEX_CALLER_FILE,
+                          int line = _FAST_MUTEX_CALLER_LINE)
+            {
+                contended = false;
+                if (_RealLock &&
+                        !fast_mutex_impl::try_lock_at(_S_mtx, file, line)) {
+                    contended = true;
+                    fast_mutex_impl::lock_at(_S_mtx, file, line);
+                }
+            }
+#   else
             lock()
             {
                 if (_RealLock) {
                     _S_mtx.lock();
                 }
             }
+            /**
+             * Constructor that reports whether the %lock was held by
+             * someone else at the time of locking.
+             *
+             * @param[out] contended  whether waiting was needed
+             */
+            explicit lock(bool& contended)
+            {
+                contended = false;
+                if (_RealLock && !_S_mtx.try_lock()) {
+                    contended = true;
+                    _S_mtx.lock();
+                }
+            }
+#   endif
             lock(const lock&) = delete;
             lock& operator=(const lock&) = delete;
             ~lock()
@@ -97,24 +146,54 @@ NVWA_NAMESPACE_BEGIN
             }
         };
 
+        /**
+         * Type that provides shared locking/unlocking semantics.  It
+         * requires the mutex type to have \c lock_shared and \c
+         * unlock_shared.
+         */
+        class shared_lock {
+        public:
+            shared_lock()
+            {
+                if (_RealLock) {
+                    _S_mtx.lock_shared();
+                }
+            }
+            shared_lock(const shared_lock&) = delete;
+            shared_lock& operator=(const shared_lock&) = delete;
+            ~shared_lock()
+            {
+                if (_RealLock) {
+                    _S_mtx.unlock_shared();
+                }
+            }
+        };
+
         typedef volatile _Host volatile_type;
     };
 
     /** Partial specialization that makes null locking. */
-    template <class _Host>
-    class class_level_lock<_Host, false> {
+    template <class _Host, class _Mutex>
+    class class_level_lock<_Host, false, _Mutex> {
     public:
         /** Type that provides locking/unlocking semantics. */
         class lock {
         public:
-            lock() = default;
+            lock() {}
+            explicit lock(bool& contended) { contended = false; }
+        };
+
+        /** Type that provides shared locking/unlocking semantics. */
+        class shared_lock {
+        public:
+            shared_lock() {}
         };
 
         typedef _Host volatile_type;
     };
 
-    template <class _Host, bool _RealLock>
-    fast_mutex class_level_lock<_Host, _RealLock>::_S_mtx;
+    template <class _Host, bool _RealLock, class _Mutex>
+    _Mutex class_level_lock<_Host, _RealLock, _Mutex>::_S_mtx;
 # endif // _NOTHREADS
 
 NVWA_NAMESPACE_END
@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2024 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,12 +31,15 @@
  *
  * Implementation of debug versions of new and delete to check leakage.
  *
- * @date  2024-05-20
+ * @date  2026-10-16
  */
 
 #include <new>                  // std::bad_alloc/nothrow_t
+#include <utility>              // std::move/std::swap
 #include <assert.h>             // assert
-#include <stdint.h>             // uint32_t/uintptr_t
+#include <math.h>               // log
+#include <stddef.h>             // offsetof
+#include <stdint.h>             // uint32_t/uint64_t/uintptr_t
 #include <stdio.h>              // fprintf/stderr/snprintf
 #include <stdlib.h>             // abort/malloc/free/posix_memalign
 #include <string.h>             // strcpy/strncpy
@@ -44,6 +47,8 @@
 
 #if NVWA_UNIX
 #include <alloca.h>             // alloca
+#include <sys/mman.h>           // mmap/mprotect/munmap
+#include <unistd.h>             // sysconf
 #endif
 #if NVWA_WIN32
 #include <malloc.h>             // alloca/_aligned_malloc/_aligned_free
@@ -130,6 +135,26 @@
 #endif
 #endif
 
+/**
+ * @def _DEBUG_NEW_CHECK_INTERVAL
+ *
+ * The initial value of nvwa#new_check_interval.  It is zero by default,
+ * i.e., memory corruption is not checked on allocation.
+ */
+#ifndef _DEBUG_NEW_CHECK_INTERVAL
+#define _DEBUG_NEW_CHECK_INTERVAL 0
+#endif
+
+/**
+ * @def _DEBUG_NEW_CHECK_SLICE
+ *
+ * Number of memory blocks checked for corruption every
+ * nvwa#new_check_interval allocations.
+ */
+#ifndef _DEBUG_NEW_CHECK_SLICE
+#define _DEBUG_NEW_CHECK_SLICE 64
+#endif
+
 /**
  * @def _DEBUG_NEW_FILENAME_LEN
  *
@@ -149,6 +174,28 @@
 #endif
 #endif
 
+/**
+ * @def _DEBUG_NEW_GUARD_PAGE_INTERVAL
+ *
+ * The initial value of nvwa#new_guard_page_interval.  It is zero by
+ * default, i.e., no memory blocks are placed before guard pages.
+ */
+#ifndef _DEBUG_NEW_GUARD_PAGE_INTERVAL
+#define _DEBUG_NEW_GUARD_PAGE_INTERVAL 0
+#endif
+
+/**
+ * @def _DEBUG_NEW_GUARD_PAGE_QUARANTINE
+ *
+ * Number of freed memory blocks with guard pages that are kept
+ * inaccessible, so that use after free causes a fault.  The oldest one
+ * is unmapped when a newer one is freed.  Set it to \c 0 to unmap the
+ * memory immediately on deallocation.
+ */
+#ifndef _DEBUG_NEW_GUARD_PAGE_QUARANTINE
+#define _DEBUG_NEW_GUARD_PAGE_QUARANTINE 64
+#endif
+
 /**
  * @def _DEBUG_NEW_PROGNAME
  *
@@ -182,6 +229,29 @@
 #define _DEBUG_NEW_REMEMBER_STACK_TRACE 0
 #endif
 
+/**
+ * @def _DEBUG_NEW_SAMPLING_RATE
+ *
+ * The initial value of nvwa#new_sampling_rate.  It is zero by default,
+ * i.e., every allocation is tracked.
+ */
+#ifndef _DEBUG_NEW_SAMPLING_RATE
+#define _DEBUG_NEW_SAMPLING_RATE 0
+#endif
+
+/**
+ * @def _DEBUG_NEW_SHARD_COUNT
+ *
+ * Number of shards of the list of allocated memory blocks.  Each shard
+ * has its own lock, and a memory block goes to a shard by the hash of
+ * its address, so that threads rarely contend on allocation and
+ * deallocation.  Define it to \c 1 to use one global list, as in older
+ * versions.
+ */
+#ifndef _DEBUG_NEW_SHARD_COUNT
+#define _DEBUG_NEW_SHARD_COUNT 16
+#endif
+
 /**
  * @def _DEBUG_NEW_TAILCHECK
  *
@@ -202,6 +272,19 @@
 #define _DEBUG_NEW_TAILCHECK_CHAR 0xCC
 #endif
 
+/**
+ * @def _DEBUG_NEW_TRACE_EVENTS
+ *
+ * Macro to indicate whether allocations and deallocations of tracked
+ * memory blocks are recorded to the binary event trace in
+ * alloc_trace.h, with the stack trace ID (if any) as the event ID.
+ * The trace is written only after nvwa#start_alloc_trace is called.
+ * Define it to \c 1 to enable it, and link in \e alloc_trace.cpp.
+ */
+#ifndef _DEBUG_NEW_TRACE_EVENTS
+#define _DEBUG_NEW_TRACE_EVENTS 0
+#endif
+
 /**
  * @def _DEBUG_NEW_USE_ADDR2LINE
  *
@@ -218,6 +301,10 @@
 #endif
 #endif
 
+#if _DEBUG_NEW_TRACE_EVENTS
+#include "alloc_trace.h"        // nvwa::trace_alloc_event
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4074)  // #pragma init_seg(compiler) used
 #if _MSC_VER >= 1400            // Visual Studio 2005 or later
@@ -244,14 +331,27 @@ struct new_ptr_list_t {
     void*           addr;       ///< Address of the caller to \e new
     };
     uint32_t        head_size;  ///< Size of this struct, aligned
-    uint32_t        line   :31; ///< Line number of the caller; or \c 0
+    uint32_t        line   :30; ///< Line number of the caller; or \c 0
     uint32_t        is_array:1; ///< Non-zero iff <em>new[]</em> is used
+    uint32_t        is_guarded:1; ///< Non-zero iff followed by guard page
 #if _DEBUG_NEW_REMEMBER_STACK_TRACE
-    void**          stacktrace; ///< Pointer to stack trace information
+    uint32_t        stacktrace_id; ///< ID of the stack trace; or \c 0
 #endif
     uint32_t        magic;      ///< Magic number for error detection
 };
 
+/**
+ * Structure to tag a memory block that is not tracked in sampling mode.
+ * It is placed immediately before the user memory.  For a tracked
+ * memory block, the same place is either the magic number of
+ * nvwa#new_ptr_list_t or zero.
+ */
+struct new_ptr_tag_t {
+    uint32_t        head_size:31; ///< Size of the header, aligned
+    uint32_t        is_array :1;  ///< Non-zero iff <em>new[]</em> is used
+    uint32_t        magic;        ///< Magic number for untracked memory
+};
+
 enum is_array_t {
     alloc_is_not_array,
     alloc_is_array
@@ -268,6 +368,13 @@ bool new_autocheck_flag = true;
  */
 bool new_verbose_flag = false;
 
+/**
+ * Flag to control whether nvwa#check_leaks reports leaks grouped by
+ * allocation site (file/line or caller address, and stack trace),
+ * instead of one line for each leaked object.
+ */
+bool new_aggregate_leaks_flag = false;
+
 /**
  * Pointer to the output stream.  The default output is \e stderr, and
  * one may change it to a user stream if needed (say, #new_verbose_flag
@@ -285,6 +392,51 @@ FILE* new_output_fp = stderr;
  */
 const char* new_progname = _DEBUG_NEW_PROGNAME;
 
+/**
+ * Average number of bytes between tracked allocations.  When it is not
+ * zero, allocations are sampled like a Poisson process on the allocated
+ * bytes, so that an allocation of \e n bytes is tracked with
+ * probability <code>1 - exp(-n / new_sampling_rate)</code>.  Untracked
+ * allocations have only a small tag, and are not reported in leak
+ * checks or counted in statistics.  It should be set before threads
+ * are started.
+ */
+size_t new_sampling_rate = _DEBUG_NEW_SAMPLING_RATE;
+
+/**
+ * Number of allocations in a thread between incremental checks for
+ * memory corruption.  When it is not zero, every so many allocations
+ * #_DEBUG_NEW_CHECK_SLICE memory blocks are checked (as by
+ * nvwa#check_mem_corruption_slice), and the error action is taken if
+ * corruption is found.
+ */
+size_t new_check_interval = _DEBUG_NEW_CHECK_INTERVAL;
+
+/**
+ * Number of eligible allocations in a thread between memory blocks
+ * placed at the end of a page followed by an inaccessible guard page.
+ * When it is not zero, an overrun of such a memory block causes a fault
+ * at the offending instruction, and so does an access after it is
+ * freed while it is in quarantine (see
+ * #_DEBUG_NEW_GUARD_PAGE_QUARANTINE).  Allocations are eligible if
+ * their sizes are between #new_guard_page_min_size and
+ * #new_guard_page_max_size (and, in sampling mode, they are tracked).
+ * Setting it to \c 1 places all eligible memory blocks before guard
+ * pages.  A memory block is allocated normally if its guard page
+ * cannot be mapped.  It is supported only on Unix.
+ */
+size_t new_guard_page_interval = _DEBUG_NEW_GUARD_PAGE_INTERVAL;
+
+/**
+ * Minimum size of allocations eligible for guard pages.
+ */
+size_t new_guard_page_min_size = 0;
+
+/**
+ * Maximum size of allocations eligible for guard pages.
+ */
+size_t new_guard_page_max_size = SIZE_MAX;
+
 /**
  * Pointer to the callback used to print the stack backtrace in case of
  * a memory problem.  A null value causes the default stack trace
@@ -298,6 +450,15 @@ stacktrace_print_callback_t stacktrace_print_callback = nullptr;
  */
 leak_whitelist_callback_t leak_whitelist_callback = nullptr;
 
+#ifdef _DEBUG
+/**
+ * Flag to simulate the failure to allocate the sites of leaked objects
+ * in nvwa#check_leaks, when nvwa#new_aggregate_leaks_flag is \c true.
+ * It is for testing only.
+ */
+bool new_leak_site_failure_flag = false;
+#endif
+
 namespace {
 
 /**
@@ -319,38 +480,56 @@ inline constexpr uint32_t align(size_t s,
  */
 constexpr uint32_t DEBUG_NEW_MAGIC = 0x4442474E;
 
+/**
+ * Definition of the constant magic number for untracked memory.
+ */
+constexpr uint32_t DEBUG_NEW_UNTRACKED_MAGIC = 0x5554524B;
+
 /**
  * The extra memory allocated by <code>operator new</code>.
  */
 constexpr uint32_t ALIGNED_LIST_ITEM_SIZE = align(sizeof(new_ptr_list_t));
 
 /**
- * List of all new'd pointers.
+ * Shard of the list of all new'd pointers.  It is aligned to avoid
+ * false sharing among threads.
  */
-new_ptr_list_t new_ptr_list = {
-    &new_ptr_list,
-    &new_ptr_list,
-    0,
-    {
-#if _DEBUG_NEW_FILENAME_LEN == 0
-        nullptr
-#else
-        ""
-#endif
-    },
-    0,
-    0,
-    0,
-#if _DEBUG_NEW_REMEMBER_STACK_TRACE
-    nullptr,
-#endif
-    DEBUG_NEW_MAGIC
+struct alignas(64) new_ptr_shard_t {
+    /**
+     * Head of the circular list.  It is zero-initialized statically, and
+     * linked to itself on first use, as memory may be allocated before
+     * dynamic initialization.
+     */
+    new_ptr_list_t list;
+    size_t         current_mem_alloc;       ///< Allocated bytes
+    size_t         current_alloc_cnt;       ///< Allocated memory blocks
+    /**
+     * Next memory block to check in nvwa#check_mem_corruption_slice;
+     * or \c nullptr to start from the beginning.  It is advanced when
+     * the memory block it points to is freed.
+     */
+    new_ptr_list_t* check_cursor;
+    size_t         total_mem_alloc_cnt;     ///< Accumulated allocations
 };
 
 /**
- * The mutex guard to protect simultaneous access to the pointer list.
+ * Mutex padded to its own cache line.
  */
-fast_mutex new_ptr_lock;
+struct alignas(64) new_ptr_lock_t {
+    fast_mutex mtx;
+};
+
+/**
+ * Shards of the list of all new'd pointers.
+ */
+new_ptr_shard_t new_ptr_shards[_DEBUG_NEW_SHARD_COUNT];
+
+/**
+ * The mutex guards to protect simultaneous access to the pointer list
+ * shards.  A shard lock may be held when acquiring #new_output_lock,
+ * but not the other way round.
+ */
+new_ptr_lock_t new_ptr_locks[_DEBUG_NEW_SHARD_COUNT];
 
 /**
  * The mutex guard to protect simultaneous output to #new_output_fp.
@@ -358,206 +537,899 @@ fast_mutex new_ptr_lock;
 fast_mutex new_output_lock;
 
 /**
- * Allocated memory in bytes.
+ * The mutex guard to protect the state of incremental corruption
+ * checks.  It is acquired before a shard lock.
+ */
+fast_mutex check_lock;
+
+/**
+ * Index of the shard to check next in incremental corruption checks.
+ */
+size_t check_shard_index = 0;
+
+/**
+ * Gets the shard index of a memory block.  A multiplicative hash is
+ * used, as memory blocks are usually spaced regularly.
+ *
+ * @param ptr  pointer to the new_ptr_list_t struct of the memory block
+ * @return     index of the shard
  */
-size_t current_mem_alloc = 0;
+inline size_t get_shard_index(const new_ptr_list_t* ptr)
+{
+    auto value = static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(ptr) / _DEBUG_NEW_ALIGNMENT);
+    uint32_t hash = value * 2654435761U;
+    return static_cast<size_t>(
+        (static_cast<uint64_t>(hash) * _DEBUG_NEW_SHARD_COUNT) >> 32);
+}
 
 /**
- * Accumulated count of total memory allocations.
+ * Gets the head of the list in a shard, linking it to itself if the
+ * list is not yet used.  The caller should hold the shard lock.
+ *
+ * @param shard  the shard
+ * @return       pointer to the list head
  */
-size_t total_mem_alloc_cnt_accum = 0;
+inline new_ptr_list_t* get_list_head(new_ptr_shard_t& shard)
+{
+    if (shard.list.next == nullptr) {
+        shard.list.next = &shard.list;
+        shard.list.prev = &shard.list;
+        shard.list.magic = DEBUG_NEW_MAGIC;
+    }
+    return &shard.list;
+}
 
 #if _DEBUG_NEW_USE_ADDR2LINE
 /**
- * Tries printing the position information from an instruction address.
- * This is the version that uses \e addr2line.
+ * Entry in the cache of symbolized addresses.
+ */
+struct symbol_cache_entry_t {
+    const void*     addr;       ///< Instruction address; or \c nullptr
+    const char*     info;       ///< Position information; or empty
+};
+
+/**
+ * Open-addressing hash table of symbolized addresses.  Entries are
+ * never removed.
+ */
+symbol_cache_entry_t* symbol_cache = nullptr;
+
+/**
+ * Number of slots in #symbol_cache (zero or a power of two).
+ */
+size_t symbol_cache_capacity = 0;
+
+/**
+ * Number of used slots in #symbol_cache.
+ */
+size_t symbol_cache_size = 0;
+
+/**
+ * The mutex guard to protect #symbol_cache.  #new_output_lock may be
+ * held when acquiring it, but not the other way round.
+ */
+fast_mutex symbol_cache_lock;
+
+/**
+ * Finds the slot of an address in #symbol_cache.  The caller should
+ * hold #symbol_cache_lock, and the cache should not be empty.
  *
- * @param addr  the instruction address to convert and print
- * @return      \c true if the address is converted successfully (and
- *              the result is printed); \c false if no useful
- *              information is got (and nothing is printed)
+ * @param addr  the instruction address
+ * @return      pointer to the slot of the address, or the empty slot
+ *              where it should be inserted
  */
-bool print_position_from_addr(const void* addr)
+symbol_cache_entry_t* find_symbol_slot(const void* addr)
 {
-    static const void* last_addr = nullptr;
-    static char last_info[256] = "";
-    if (addr == last_addr) {
-        if (last_info[0] == '\0') {
-            return false;
+    size_t mask = symbol_cache_capacity - 1;
+    size_t index = static_cast<size_t>(
+        (reinterpret_cast<uintptr_t>(addr) * UINT64_C(0x9E3779B97F4A7C15))
+        >> 16) & mask;
+    while (symbol_cache[index].addr != nullptr &&
+           symbol_cache[index].addr != addr) {
+        index = (index + 1) & mask;
+    }
+    return &symbol_cache[index];
+}
+
+/**
+ * Looks up an address in #symbol_cache.  The caller should hold
+ * #symbol_cache_lock.
+ *
+ * @param addr  the instruction address
+ * @return      position information (empty if symbolization failed);
+ *              or \c nullptr if the address is not cached
+ */
+const char* lookup_symbol(const void* addr)
+{
+    if (symbol_cache_size == 0) {
+        return nullptr;
+    }
+    return find_symbol_slot(addr)->info;
+}
+
+/**
+ * Adds a symbolized address to #symbol_cache.  The caller should hold
+ * #symbol_cache_lock.
+ *
+ * @param addr  the instruction address
+ * @param info  position information (empty if symbolization failed)
+ */
+void add_symbol(const void* addr, const char* info)
+{
+    if ((symbol_cache_size + 1) * 2 > symbol_cache_capacity) {
+        size_t old_capacity = symbol_cache_capacity;
+        symbol_cache_entry_t* old_cache = symbol_cache;
+        size_t capacity = old_capacity == 0 ? 256 : old_capacity * 2;
+        auto cache = static_cast<symbol_cache_entry_t*>(
+            calloc(capacity, sizeof(symbol_cache_entry_t)));
+        if (cache == nullptr) {
+            return;
         }
-        fprintf(new_output_fp, "%s", last_info);
-        return true;
+        symbol_cache = cache;
+        symbol_cache_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_cache[i].addr != nullptr) {
+                *find_symbol_slot(old_cache[i].addr) = old_cache[i];
+            }
+        }
+        free(old_cache);
+    }
+    symbol_cache_entry_t* slot = find_symbol_slot(addr);
+    if (slot->addr != nullptr) {
+        return;
+    }
+    if (info[0] != '\0') {
+        auto copy = static_cast<char*>(malloc(strlen(info) + 1));
+        if (copy == nullptr) {
+            return;
+        }
+        info = strcpy(copy, info);
+    } else {
+        info = "";
+    }
+    slot->addr = addr;
+    slot->info = info;
+    ++symbol_cache_size;
+}
+
+/**
+ * Creates a temporary file to pass addresses to \e addr2line.
+ *
+ * @param[out] path  the path of the file
+ * @param size       size of the buffer of \a path
+ * @return           the file opened for writing; or \c nullptr if it
+ *                   cannot be created
+ */
+FILE* create_addr_file(char* path, size_t size)
+{
+#if NVWA_UNIX
+    const char* dir = getenv("TMPDIR");
+    if (dir == nullptr || dir[0] == '\0') {
+        dir = "/tmp";
+    }
+    int len = snprintf(path, size, "%s/debug_new.XXXXXX", dir);
+    if (len < 0 || size_t(len) >= size) {
+        return nullptr;
+    }
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return nullptr;
+    }
+    FILE* fp = fdopen(fd, "w");
+    if (fp == nullptr) {
+        close(fd);
+        remove(path);
+    }
+    return fp;
+#elif NVWA_WINDOWS
+    char dir[MAX_PATH];
+    DWORD len = GetTempPathA(sizeof dir, dir);
+    if (len == 0 || len >= sizeof dir || size < MAX_PATH ||
+            GetTempFileNameA(dir, "dbn", 0, path) == 0) {
+        return nullptr;
+    }
+    FILE* fp = fopen(path, "w");
+    if (fp == nullptr) {
+        remove(path);
     }
-    if (new_progname) {
+    return fp;
+#else
+    (void)path;
+    (void)size;
+    return nullptr;
+#endif
+}
+
+/**
+ * Runs \e addr2line once on instruction addresses, and caches the
+ * results.  The addresses are written to a temporary file, which is
+ * fed to \e addr2line as the standard input, so that the number of
+ * addresses is not limited by the command line length.
+ *
+ * @param addrs  the instruction addresses
+ * @param count  number of addresses
+ * @return       number of addresses (from the beginning) cached
+ */
+size_t run_addr2line(const void* const* addrs, size_t count)
+{
 #if NVWA_APPLE
-        const char addr2line_cmd[] = "atos -o ";
+    const char addr2line_cmd[] = "atos -o ";
 #else
-        const char addr2line_cmd[] = "addr2line -e ";
+    const char addr2line_cmd[] = "addr2line -e ";
 #endif
 
 #if NVWA_WINDOWS
-        const int  exeext_len = 4;
+    const int  exeext_len = 4;
 #else
-        const int  exeext_len = 0;
+    const int  exeext_len = 0;
 #endif
 
 #if NVWA_UNIX && !NVWA_CYGWIN
-        const char ignore_err[] = " 2>/dev/null";
+    const char ignore_err[] = " 2>/dev/null";
 #elif NVWA_CYGWIN || \
         (NVWA_WIN32 && defined(WINVER) && WINVER >= 0x0500)
-        const char ignore_err[] = " 2>nul";
+    const char ignore_err[] = " 2>nul";
 #else
-        const char ignore_err[] = "";
-#endif
-        auto prog_len = strlen(new_progname);
-        auto buf_len = prog_len + exeext_len + sizeof addr2line_cmd - 1 +
-                       sizeof ignore_err - 1 + sizeof(void*) * 2 +
-                       4 /* SP + "0x" + null */;
-        auto cmd = static_cast<char*>(alloca(buf_len));
-        size_t len = 0;
-        strcpy(cmd, addr2line_cmd);
-        len += sizeof addr2line_cmd - 1;
-        strcpy(cmd + len, new_progname);
-        len += prog_len;
+    const char ignore_err[] = "";
+#endif
+    const char redirect_input[] = " <\"";
+
+    char path[1024];
+    FILE* addr_fp = create_addr_file(path, sizeof path);
+    if (addr_fp == nullptr) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(addr_fp, "%p\n", addrs[i]);
+    }
+    if (fclose(addr_fp) != 0) {
+        remove(path);
+        return 0;
+    }
+
+    auto prog_len = strlen(new_progname);
+    auto buf_len = prog_len + exeext_len + sizeof addr2line_cmd - 1 +
+                   sizeof redirect_input - 1 + strlen(path) +
+                   1 /* quote */ + sizeof ignore_err - 1 + 1;
+    auto cmd = static_cast<char*>(malloc(buf_len));
+    if (cmd == nullptr) {
+        remove(path);
+        return 0;
+    }
+    size_t len = 0;
+    strcpy(cmd, addr2line_cmd);
+    len += sizeof addr2line_cmd - 1;
+    strcpy(cmd + len, new_progname);
+    len += prog_len;
 #if NVWA_WINDOWS
-        if (len <= 4 || (strcmp(cmd + len - 4, ".exe") != 0 &&
-                         strcmp(cmd + len - 4, ".EXE") != 0)) {
-            strcpy(cmd + len, ".exe");
-            len += 4;
-        }
+    if (len <= 4 || (strcmp(cmd + len - 4, ".exe") != 0 &&
+                     strcmp(cmd + len - 4, ".EXE") != 0)) {
+        strcpy(cmd + len, ".exe");
+        len += 4;
+    }
 #endif
-        snprintf(cmd + len, buf_len - len, " %p%s", addr, ignore_err);
-        FILE* fp = popen(cmd, "r");
-        if (fp) {
-            char buffer[sizeof last_info] = "";
-            len = 0;
-            if (fgets(buffer, sizeof buffer, fp)) {
-                len = strlen(buffer);
-                if (buffer[len - 1] == '\n') {
-                    buffer[--len] = '\0';
+    snprintf(cmd + len, buf_len - len, "%s%s\"%s",
+             redirect_input, path, ignore_err);
+
+    // One line is output for each address
+    FILE* fp = popen(cmd, "r");
+    free(cmd);
+    size_t line_cnt = 0;
+    if (fp != nullptr) {
+        char buffer[256];
+        while (line_cnt < count && fgets(buffer, sizeof buffer, fp)) {
+            len = strlen(buffer);
+            if (len > 0 && buffer[len - 1] == '\n') {
+                buffer[--len] = '\0';
+            } else {
+                // Discard the rest of an overlong line
+                int ch;
+                while ((ch = getc(fp)) != EOF && ch != '\n') {
                 }
             }
-            int res = pclose(fp);
-            // Display the file/line information only if the command
-            // is executed successfully and the output points to a
-            // valid position, but the result will be cached if only
-            // the command is executed successfully.
-            if (res == 0 && len > 0) {
-                last_addr = addr;
-                if (buffer[len - 1] == '0' && buffer[len - 2] == ':') {
-                    last_info[0] = '\0';
-                } else {
-                    fprintf(new_output_fp, "%s", buffer);
-                    strcpy(last_info, buffer);
-                    return true;
-                }
+            // Unknown positions look like "??:0"
+            if (len < 2 || (buffer[len - 1] == '0' &&
+                            buffer[len - 2] == ':')) {
+                buffer[0] = '\0';
             }
+            fast_mutex_autolock lock(symbol_cache_lock);
+            add_symbol(addrs[line_cnt++], buffer);
         }
+        pclose(fp);
     }
-    return false;
+    remove(path);
+    return line_cnt;
 }
-#else
+
 /**
- * Tries printing the position information from an instruction address.
- * This is the stub version that does nothing at all.
+ * Symbolizes instruction addresses with one invocation of \e addr2line,
+ * and caches the results.  Addresses that cannot be symbolized are
+ * cached too, so that \e addr2line is not run again for them.
  *
- * @return      \c false always
+ * @param addrs  the instruction addresses
+ * @param count  number of addresses
  */
-bool print_position_from_addr(const void*)
+void symbolize_batch(const void* const* addrs, size_t count)
 {
-    return false;
+    size_t cached_cnt = run_addr2line(addrs, count);
+    fast_mutex_autolock lock(symbol_cache_lock);
+    for (size_t i = cached_cnt; i < count; ++i) {
+        add_symbol(addrs[i], "");
+    }
 }
-#endif // _DEBUG_NEW_USE_ADDR2LINE
 
 /**
- * Prints the position information of a memory operation point.  When \c
- * _DEBUG_NEW_USE_ADDR2LINE is defined to a non-zero value, this
- * function will try to convert a given caller address to file/line
- * information with \e addr2line.
+ * Symbolizes instruction addresses that are not yet cached, in one
+ * invocation of \e addr2line.  No locks should be held when calling
+ * it.
  *
- * @param ptr   source file name if \e line is non-zero; caller address
- *              otherwise
- * @param line  source line number if non-zero; indication that \e ptr
- *              is the caller address otherwise
+ * @param addrs  the instruction addresses, preferably unique
+ * @param count  number of addresses
  */
-void print_position(const void* ptr, int line)
+void symbolize_addrs(const void* const* addrs, size_t count)
 {
-    if (line != 0) {               // Is file/line information present?
-        fprintf(new_output_fp, "%s:%d", static_cast<const char*>(ptr), line);
-    } else if (ptr != nullptr) {   // Is caller address present?
-        if (!print_position_from_addr(ptr)) { // Fail to get source position?
-            fprintf(new_output_fp, "%p", ptr);
+    if (new_progname == nullptr || count == 0) {
+        return;
+    }
+    auto uncached = static_cast<const void**>(
+        malloc(count * sizeof(void*)));
+    if (uncached == nullptr) {
+        return;
+    }
+    size_t uncached_cnt = 0;
+    {
+        fast_mutex_autolock lock(symbol_cache_lock);
+        for (size_t i = 0; i < count; ++i) {
+            if (addrs[i] != nullptr && lookup_symbol(addrs[i]) == nullptr) {
+                uncached[uncached_cnt++] = addrs[i];
+            }
         }
-    } else {                       // No information is present
-        fprintf(new_output_fp, "<Unknown>");
     }
+    if (uncached_cnt > 0) {
+        symbolize_batch(uncached, uncached_cnt);
+    }
+    free(uncached);
 }
 
-#if _DEBUG_NEW_REMEMBER_STACK_TRACE
 /**
- * Prints the stack backtrace.
- *
- * When nvwa#stacktrace_print_callback is not null, it is used for
- * printing the stacktrace items.  Default implementation of call stack
- * printing is very spartan&mdash;only stack frame pointers are
- * printed&mdash;but even that output is still useful.  Just do address
- * lookup in LLDB etc.
+ * Symbolizes the caller address of a memory operation point, if it is
+ * not yet cached.  It should be called before taking the locks under
+ * which the position is printed.
  *
- * @param stacktrace  pointer to the stack trace array
+ * @param ptr   source file name if \e line is non-zero; caller address
+ *              otherwise
+ * @param line  source line number if non-zero; indication that \e ptr
+ *              is the caller address otherwise
  */
-void print_stacktrace(void** stacktrace)
+void symbolize_position(const void* ptr, int line)
 {
-    if (stacktrace_print_callback == nullptr) {
-        fprintf(new_output_fp, "Stack backtrace:\n");
-        for (size_t i = 0; stacktrace[i] != nullptr; ++i) {
-            fprintf(new_output_fp, "%p\n", stacktrace[i]);
-        }
-    } else {
-        stacktrace_print_callback(new_output_fp, stacktrace);
+    if (line == 0 && ptr != nullptr) {
+        symbolize_addrs(&ptr, 1);
     }
 }
-#endif
 
 /**
- * Checks whether a leak should be ignored.  Its runtime performance
- * depends on the callback nvwa#leak_whitelist_callback.
+ * Checks whether the position of a memory block can be printed without
+ * running \e addr2line.  The caller may hold any locks.
  *
  * @param ptr  pointer to a new_ptr_list_t struct
- * @return     \c true if the leak should be whitelisted; \c false
+ * @return     \c true if the position is file/line information or a
+ *             cached (or unsymbolizable) caller address; \c false
  *             otherwise
  */
-bool is_leak_whitelisted(new_ptr_list_t* ptr)
+bool is_position_resolved(const new_ptr_list_t* ptr)
 {
-    if (leak_whitelist_callback == nullptr) {
-        return false;
+    if (ptr->line != 0 || ptr->addr == nullptr || new_progname == nullptr) {
+        return true;
     }
-
-    char const* file = ptr->line != 0 ? ptr->file : nullptr;
-    int line = ptr->line;
-    void* addr = ptr->line == 0 ? ptr->addr : nullptr;
-#if _DEBUG_NEW_REMEMBER_STACK_TRACE
-    void** stacktrace = ptr->stacktrace;
-#else
-    void** stacktrace = nullptr;
-#endif
-
-    return leak_whitelist_callback(file, line, addr, stacktrace);
+    fast_mutex_autolock lock(symbol_cache_lock);
+    return lookup_symbol(ptr->addr) != nullptr;
 }
 
-#if _DEBUG_NEW_TAILCHECK
 /**
- * Checks whether the padding bytes at the end of a memory block is
- * tampered with.
+ * Tries printing the position information from an instruction address.
+ * This is the version that uses \e addr2line.  Only cached results are
+ * used, as locks are usually held when printing, and
+ * nvwa#symbolize_addrs should be used to fill the cache in advance.
  *
- * @param ptr  pointer to a new_ptr_list_t struct
- * @return     \c true if the padding bytes are untouched; \c false
- *             otherwise
+ * @param addr  the instruction address to convert and print
+ * @return      \c true if the address is converted successfully (and
+ *              the result is printed); \c false if no useful
+ *              information is got (and nothing is printed)
+ */
+bool print_position_from_addr(const void* addr)
+{
+    const char* info;
+    {
+        fast_mutex_autolock lock(symbol_cache_lock);
+        info = lookup_symbol(addr);
+    }
+    if (info == nullptr || info[0] == '\0') {
+        return false;
+    }
+    fprintf(new_output_fp, "%s", info);
+    return true;
+}
+
+/**
+ * Compares two addresses for \e qsort.
+ */
+int compare_addr(const void* lhs, const void* rhs)
+{
+    auto lhs_addr = reinterpret_cast<uintptr_t>(
+        *static_cast<const void* const*>(lhs));
+    auto rhs_addr = reinterpret_cast<uintptr_t>(
+        *static_cast<const void* const*>(rhs));
+    return lhs_addr < rhs_addr ? -1 : (lhs_addr > rhs_addr ? 1 : 0);
+}
+
+/**
+ * Symbolizes instruction addresses that may contain duplicates.  The
+ * addresses are sorted and made unique in place first.
+ *
+ * @param addrs  the instruction addresses
+ * @param count  number of addresses
+ */
+void symbolize_unique_addrs(const void** addrs, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    qsort(addrs, count, sizeof(void*), compare_addr);
+    size_t unique_cnt = 1;
+    for (size_t i = 1; i < count; ++i) {
+        if (addrs[i] != addrs[unique_cnt - 1]) {
+            addrs[unique_cnt++] = addrs[i];
+        }
+    }
+    symbolize_addrs(addrs, unique_cnt);
+}
+
+#if _DEBUG_NEW_TAILCHECK
+bool check_tail(new_ptr_list_t* ptr);
+#endif
+
+/**
+ * Symbolizes the caller addresses of allocations in advance, so that a
+ * report needs only one invocation of \e addr2line, run without holding
+ * any locks.
+ *
+ * @param corrupt_only  \c true if only corrupt memory blocks are
+ *                      reported; \c false if all are
+ */
+void symbolize_positions(bool corrupt_only)
+{
+    const void** addrs = nullptr;
+    size_t count = 0;
+    size_t capacity = 0;
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        fast_mutex_autolock lock(new_ptr_locks[i].mtx);
+        new_ptr_list_t* head = get_list_head(new_ptr_shards[i]);
+        for (new_ptr_list_t* ptr = head->next; ptr != head;
+                ptr = ptr->next) {
+            if (ptr->line != 0 || ptr->addr == nullptr) {
+                continue;
+            }
+            if (corrupt_only && ptr->magic == DEBUG_NEW_MAGIC
+#if _DEBUG_NEW_TAILCHECK
+                && check_tail(ptr)
+#endif
+            ) {
+                continue;
+            }
+            if (count == capacity) {
+                capacity = capacity == 0 ? 256 : capacity * 2;
+                auto new_addrs = static_cast<const void**>(
+                    realloc(addrs, capacity * sizeof(void*)));
+                if (new_addrs == nullptr) {
+                    free(addrs);
+                    return;
+                }
+                addrs = new_addrs;
+            }
+            addrs[count++] = ptr->addr;
+        }
+    }
+    symbolize_unique_addrs(addrs, count);
+    free(addrs);
+}
+#else
+/**
+ * Tries printing the position information from an instruction address.
+ * This is the stub version that does nothing at all.
+ *
+ * @return      \c false always
+ */
+bool print_position_from_addr(const void*)
+{
+    return false;
+}
+
+/**
+ * Symbolizes instruction addresses in advance.  This is the stub
+ * version that does nothing at all.
+ */
+void symbolize_addrs(const void* const*, size_t)
+{
+}
+
+/**
+ * Symbolizes the caller address of a memory operation point.  This is
+ * the stub version that does nothing at all.
+ */
+void symbolize_position(const void*, int)
+{
+}
+
+/**
+ * Checks whether the position of a memory block can be printed.  This
+ * is the stub version that always succeeds.
+ *
+ * @return      \c true always
+ */
+bool is_position_resolved(const new_ptr_list_t*)
+{
+    return true;
+}
+
+/**
+ * Symbolizes instruction addresses that may contain duplicates.  This
+ * is the stub version that does nothing at all.
+ */
+void symbolize_unique_addrs(const void**, size_t)
+{
+}
+
+/**
+ * Symbolizes the caller addresses of allocations in advance.  This is
+ * the stub version that does nothing at all.
+ */
+void symbolize_positions(bool)
+{
+}
+#endif // _DEBUG_NEW_USE_ADDR2LINE
+
+/**
+ * Prints the position information of a memory operation point.  When \c
+ * _DEBUG_NEW_USE_ADDR2LINE is defined to a non-zero value, this
+ * function will try to convert a given caller address to file/line
+ * information with \e addr2line.
+ *
+ * @param ptr   source file name if \e line is non-zero; caller address
+ *              otherwise
+ * @param line  source line number if non-zero; indication that \e ptr
+ *              is the caller address otherwise
+ */
+void print_position(const void* ptr, int line)
+{
+    if (line != 0) {               // Is file/line information present?
+        fprintf(new_output_fp, "%s:%d", static_cast<const char*>(ptr), line);
+    } else if (ptr != nullptr) {   // Is caller address present?
+        if (!print_position_from_addr(ptr)) { // Fail to get source position?
+            fprintf(new_output_fp, "%p", ptr);
+        }
+    } else {                       // No information is present
+        fprintf(new_output_fp, "<Unknown>");
+    }
+}
+
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+/**
+ * Structure of an interned stack trace.  Allocations from the same call
+ * stack share one entry.
+ */
+struct stacktrace_entry_t {
+    stacktrace_entry_t* next;   ///< Next entry in the hash bucket
+    size_t          hash;       ///< Hash value of the frames
+    uint32_t        id;         ///< ID of the stack trace
+    uint32_t        ref_cnt;    ///< Count of allocations referring to it
+    uint32_t        length;     ///< Number of frames
+    void*           frames[1];  ///< Frames, null-terminated
+};
+
+/**
+ * Number of buckets in the hash table of stack traces.
+ */
+constexpr size_t STACKTRACE_BUCKET_CNT = 4096;
+
+/**
+ * Hash table of interned stack traces.
+ */
+stacktrace_entry_t* stacktrace_buckets[STACKTRACE_BUCKET_CNT];
+
+/**
+ * Table from stack trace IDs (minus one) to entries.
+ */
+stacktrace_entry_t** stacktrace_table = nullptr;
+
+/**
+ * Stack of stack trace IDs that are free for reuse.
+ */
+uint32_t* stacktrace_free_ids = nullptr;
+
+/**
+ * Count of free stack trace IDs.
+ */
+size_t stacktrace_free_id_cnt = 0;
+
+/**
+ * Count of used slots in #stacktrace_table.
+ */
+size_t stacktrace_table_size = 0;
+
+/**
+ * Capacity of #stacktrace_table and #stacktrace_free_ids.
+ */
+size_t stacktrace_table_capacity = 0;
+
+/**
+ * The mutex guard to protect the stack trace tables.  No other locks
+ * should be acquired when holding it.
+ */
+fast_mutex stacktrace_lock;
+
+/**
+ * Allocates an ID for a stack trace entry.  The caller should hold
+ * #stacktrace_lock.
+ *
+ * @return  the ID if successful; \c 0 otherwise
+ */
+uint32_t alloc_stacktrace_id()
+{
+    if (stacktrace_free_id_cnt > 0) {
+        return stacktrace_free_ids[--stacktrace_free_id_cnt];
+    }
+    if (stacktrace_table_size == stacktrace_table_capacity) {
+        size_t capacity = stacktrace_table_capacity == 0
+                              ? 256
+                              : stacktrace_table_capacity * 2;
+        auto table = static_cast<stacktrace_entry_t**>(
+            realloc(stacktrace_table, capacity * sizeof(void*)));
+        if (table == nullptr) {
+            return 0;
+        }
+        stacktrace_table = table;
+        auto free_ids = static_cast<uint32_t*>(
+            realloc(stacktrace_free_ids, capacity * sizeof(uint32_t)));
+        if (free_ids == nullptr) {
+            return 0;
+        }
+        stacktrace_free_ids = free_ids;
+        stacktrace_table_capacity = capacity;
+    }
+    return static_cast<uint32_t>(++stacktrace_table_size);
+}
+
+/**
+ * Interns a stack trace, and adds a reference to it.
+ *
+ * @param frames  the frames of the stack trace
+ * @param length  number of frames
+ * @return        ID of the stack trace if successful; \c 0 otherwise
+ */
+uint32_t intern_stacktrace(void* const* frames, size_t length)
+{
+    size_t hash = length;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) *
+               static_cast<size_t>(UINT64_C(0x100000001B3));
+    }
+    size_t frames_size = length * sizeof(void*);
+    stacktrace_entry_t** bucket =
+        &stacktrace_buckets[hash % STACKTRACE_BUCKET_CNT];
+
+    fast_mutex_autolock lock(stacktrace_lock);
+    for (auto entry = *bucket; entry != nullptr; entry = entry->next) {
+        if (entry->hash == hash && entry->length == length &&
+                memcmp(entry->frames, frames, frames_size) == 0) {
+            ++entry->ref_cnt;
+            return entry->id;
+        }
+    }
+
+    uint32_t id = alloc_stacktrace_id();
+    if (id == 0) {
+        return 0;
+    }
+    auto entry = static_cast<stacktrace_entry_t*>(
+        malloc(sizeof(stacktrace_entry_t) + frames_size));
+    if (entry == nullptr) {
+        stacktrace_free_ids[stacktrace_free_id_cnt++] = id;
+        return 0;
+    }
+    entry->next = *bucket;
+    entry->hash = hash;
+    entry->id = id;
+    entry->ref_cnt = 1;
+    entry->length = static_cast<uint32_t>(length);
+    memcpy(entry->frames, frames, frames_size);
+    entry->frames[length] = nullptr;
+    *bucket = entry;
+    stacktrace_table[id - 1] = entry;
+    return id;
+}
+
+/**
+ * Finds an interned stack trace.  The ID is checked, as it may come
+ * from the header of a corrupt memory block.  The caller should hold
+ * #stacktrace_lock.
+ *
+ * @param id  ID of the stack trace; or \c 0
+ * @return    pointer to the stack trace entry; or \c nullptr if \a id
+ *            is \c 0, out of range, or no longer in use
+ */
+stacktrace_entry_t* find_stacktrace(uint32_t id)
+{
+    if (id == 0 || id > stacktrace_table_size) {
+        return nullptr;
+    }
+    return stacktrace_table[id - 1];
+}
+
+/**
+ * Adds a reference to an interned stack trace.
+ *
+ * @param id  ID of the stack trace; or \c 0
+ */
+void retain_stacktrace(uint32_t id)
+{
+    if (id == 0) {
+        return;
+    }
+    fast_mutex_autolock lock(stacktrace_lock);
+    if (stacktrace_entry_t* entry = find_stacktrace(id)) {
+        ++entry->ref_cnt;
+    }
+}
+
+/**
+ * Removes a reference to an interned stack trace.  The stack trace is
+ * freed when no references remain.
+ *
+ * @param id  ID of the stack trace; or \c 0
+ */
+void release_stacktrace(uint32_t id)
+{
+    if (id == 0) {
+        return;
+    }
+    fast_mutex_autolock lock(stacktrace_lock);
+    stacktrace_entry_t* entry = find_stacktrace(id);
+    if (entry == nullptr || --entry->ref_cnt != 0) {
+        return;
+    }
+    stacktrace_entry_t** link =
+        &stacktrace_buckets[entry->hash % STACKTRACE_BUCKET_CNT];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    stacktrace_table[id - 1] = nullptr;
+    stacktrace_free_ids[stacktrace_free_id_cnt++] = id;
+    free(entry);
+}
+
+/**
+ * Gets the frames of an interned stack trace.  The result stays valid
+ * as long as a reference to the stack trace is held.
+ *
+ * @param id  ID of the stack trace; or \c 0
+ * @return    pointer to the null-terminated frames; or \c nullptr if
+ *            \a id is \c 0, invalid, or stale
+ */
+void** get_stacktrace(uint32_t id)
+{
+    if (id == 0) {
+        return nullptr;
+    }
+    fast_mutex_autolock lock(stacktrace_lock);
+    stacktrace_entry_t* entry = find_stacktrace(id);
+    return entry != nullptr ? entry->frames : nullptr;
+}
+
+/**
+ * Prints the stack backtrace.
+ *
+ * When nvwa#stacktrace_print_callback is not null, it is used for
+ * printing the stacktrace items.  Default implementation of call stack
+ * printing is very spartan&mdash;only stack frame pointers are
+ * printed&mdash;but even that output is still useful.  Just do address
+ * lookup in LLDB etc.
+ *
+ * @param stacktrace  pointer to the stack trace array; or \c nullptr
+ */
+void print_stacktrace(void** stacktrace)
+{
+    if (stacktrace == nullptr) {
+        return;
+    }
+    if (stacktrace_print_callback == nullptr) {
+        fprintf(new_output_fp, "Stack backtrace:\n");
+        for (size_t i = 0; stacktrace[i] != nullptr; ++i) {
+            fprintf(new_output_fp, "%p\n", stacktrace[i]);
+        }
+    } else {
+        stacktrace_print_callback(new_output_fp, stacktrace);
+    }
+}
+#endif
+
+/**
+ * Checks whether a leak should be ignored.  Its runtime performance
+ * depends on the callback nvwa#leak_whitelist_callback.
+ *
+ * @param ptr  pointer to a new_ptr_list_t struct
+ * @return     \c true if the leak should be whitelisted; \c false
+ *             otherwise
+ */
+bool is_leak_whitelisted(new_ptr_list_t* ptr)
+{
+    if (leak_whitelist_callback == nullptr) {
+        return false;
+    }
+
+    char const* file = ptr->line != 0 ? ptr->file : nullptr;
+    int line = ptr->line;
+    void* addr = ptr->line == 0 ? ptr->addr : nullptr;
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    void** stacktrace = get_stacktrace(ptr->stacktrace_id);
+#else
+    void** stacktrace = nullptr;
+#endif
+
+    return leak_whitelist_callback(file, line, addr, stacktrace);
+}
+
+#if NVWA_UNIX
+/**
+ * Gets the size of a memory page.
+ *
+ * @return  the page size in bytes
+ */
+size_t get_page_size()
+{
+    static size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+}
+#endif
+
+#if _DEBUG_NEW_TAILCHECK
+/**
+ * Gets the number of padding bytes at the end of a memory block.  For a
+ * memory block before a guard page, they are the bytes left by the
+ * alignment, so that an overrun still causes an immediate fault.
+ *
+ * @param ptr  pointer to a new_ptr_list_t struct
+ * @return     the number of padding bytes
+ */
+inline size_t get_tail_size(const new_ptr_list_t* ptr)
+{
+#if NVWA_UNIX
+    if (ptr->is_guarded) {
+        size_t page_size = get_page_size();
+        auto usr_end = reinterpret_cast<uintptr_t>(ptr) + ptr->head_size +
+                       ptr->size;
+        return (page_size - usr_end % page_size) % page_size;
+    }
+#endif
+    return _DEBUG_NEW_TAILCHECK;
+}
+
+/**
+ * Checks whether the padding bytes at the end of a memory block is
+ * tampered with.
+ *
+ * @param ptr  pointer to a new_ptr_list_t struct
+ * @return     \c true if the padding bytes are untouched; \c false
+ *             otherwise
  */
 bool check_tail(new_ptr_list_t* ptr)
 {
     auto const tail_ptr = reinterpret_cast<const unsigned char*>(ptr) +
                           ptr->size + ptr->head_size;
-    for (int i = 0; i < _DEBUG_NEW_TAILCHECK; ++i) {
+    size_t tail_size = get_tail_size(ptr);
+    for (size_t i = 0; i < tail_size; ++i) {
         if (tail_ptr[i] != _DEBUG_NEW_TAILCHECK_CHAR) {
             return false;
         }
@@ -642,19 +1514,224 @@ void* debug_new_alloc(size_t size, size_t alignment = _DEBUG_NEW_ALIGNMENT)
 }
 
 /**
- * Deallocates memory for debug_new.
+ * Deallocates memory for debug_new.
+ *
+ * @param ptr  pointer to the memory to deallocate
+ */
+void debug_new_free(void* ptr)
+{
+#if NVWA_WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+#if NVWA_UNIX
+/**
+ * Decides whether an allocation should be placed before a guard page.
+ *
+ * @param size       size of the allocation
+ * @param alignment  alignment requested
+ * @return           \c true if a guard page should be used; \c false
+ *                   otherwise
+ */
+bool should_guard(size_t size, size_t alignment)
+{
+    static thread_local size_t alloc_cnt = 0;
+    if (size < new_guard_page_min_size || size > new_guard_page_max_size ||
+            alignment > get_page_size()) {
+        return false;
+    }
+    if (++alloc_cnt < new_guard_page_interval) {
+        return false;
+    }
+    alloc_cnt = 0;
+    return true;
+}
+
+/**
+ * Allocates memory so that the user memory ends (as closely as the
+ * alignment allows) immediately before an inaccessible guard page.
+ *
+ * @param size       size of the user memory
+ * @param head_size  size of the control data before the user memory
+ * @param alignment  alignment requested; not greater than the page size
+ * @return           pointer to the control data if successful;
+ *                   \c nullptr otherwise
+ */
+new_ptr_list_t* alloc_guarded(size_t size, uint32_t head_size,
+                              size_t alignment)
+{
+    size_t page_size = get_page_size();
+    if (size > SIZE_MAX - head_size - alignment - page_size * 2) {
+        return nullptr;
+    }
+    size_t data_size = (size + alignment - 1) / alignment * alignment +
+                       head_size;
+    size_t map_size = (data_size + page_size - 1) / page_size * page_size +
+                      page_size;
+    void* addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    auto guard_ptr = static_cast<char*>(addr) + map_size - page_size;
+    if (mprotect(guard_ptr, page_size, PROT_NONE) != 0) {
+        munmap(addr, map_size);
+        return nullptr;
+    }
+    auto usr_ptr = reinterpret_cast<uintptr_t>(guard_ptr) - size;
+    usr_ptr &= ~static_cast<uintptr_t>(alignment - 1);
+    return reinterpret_cast<new_ptr_list_t*>(usr_ptr - head_size);
+}
+
+/**
+ * Memory mapping of a memory block with a guard page.
+ */
+struct guarded_mapping_t {
+    void*           addr;       ///< Start address of the mapping
+    size_t          size;       ///< Size of the mapping
+};
+
+#if _DEBUG_NEW_GUARD_PAGE_QUARANTINE
+
+/**
+ * Ring buffer of the freed memory blocks in quarantine.
+ */
+guarded_mapping_t guard_page_quarantine[_DEBUG_NEW_GUARD_PAGE_QUARANTINE];
+
+/**
+ * Index of the oldest item in #guard_page_quarantine.
+ */
+size_t guard_page_quarantine_index = 0;
+
+/**
+ * The mutex guard to protect simultaneous access to
+ * #guard_page_quarantine.
+ */
+fast_mutex guard_page_quarantine_lock;
+#endif
+
+/**
+ * Frees a memory block allocated by #alloc_guarded.  The memory is made
+ * inaccessible and put into quarantine, if quarantine is enabled.
+ *
+ * @param ptr  pointer to the control data
+ */
+void free_guarded(new_ptr_list_t* ptr)
+{
+    size_t page_size = get_page_size();
+    auto start = reinterpret_cast<uintptr_t>(ptr) / page_size * page_size;
+    auto usr_end = reinterpret_cast<uintptr_t>(ptr) + ptr->head_size +
+                   ptr->size;
+    auto guard = (usr_end + page_size - 1) / page_size * page_size;
+    guarded_mapping_t mapping = {reinterpret_cast<void*>(start),
+                                 guard + page_size - start};
+#if _DEBUG_NEW_GUARD_PAGE_QUARANTINE
+    mprotect(mapping.addr, guard - start, PROT_NONE);
+    {
+        fast_mutex_autolock lock(guard_page_quarantine_lock);
+        guarded_mapping_t& slot =
+            guard_page_quarantine[guard_page_quarantine_index];
+        guarded_mapping_t evicted = slot;
+        slot = mapping;
+        mapping = evicted;
+        guard_page_quarantine_index = (guard_page_quarantine_index + 1) %
+                                      _DEBUG_NEW_GUARD_PAGE_QUARANTINE;
+    }
+    if (mapping.addr == nullptr) {
+        return;
+    }
+#endif
+    munmap(mapping.addr, mapping.size);
+}
+#endif
+
+/**
+ * Decides whether an allocation should be tracked in sampling mode.
+ * Each thread counts down the bytes to the next sample, and draws the
+ * distance between samples from an exponential distribution.
+ *
+ * @param size  size of the allocation
+ * @return      \c true if the allocation should be tracked; \c false
+ *              otherwise
+ */
+bool should_sample(size_t size)
+{
+    static thread_local uint64_t rng_state = 0;
+    static thread_local size_t bytes_until_sample = 0;
+    bool initialized = rng_state != 0;
+    if (initialized && bytes_until_sample > size) {
+        bytes_until_sample -= size;
+        return false;
+    }
+    if (!initialized) {
+        rng_state = (reinterpret_cast<uintptr_t>(&rng_state) *
+                     UINT64_C(0x9E3779B97F4A7C15)) | 1;
+    }
+    // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    double u = static_cast<double>(rng_state >> 11) / 9007199254740992.0;
+    bytes_until_sample =
+        static_cast<size_t>(-log(1.0 - u) * new_sampling_rate) + 1;
+    if (!initialized) {
+        return should_sample(size);
+    }
+    return true;
+}
+
+/**
+ * Allocates memory that is not tracked in sampling mode.
+ *
+ * @param size       size of the required memory block
+ * @param is_array   flag indicating whether it is invoked by a
+ *                   <code>new[]</code> call
+ * @param alignment  alignment requested
+ * @return           pointer to the user-requested memory area;
+ *                   \c nullptr if memory allocation is not successful
+ */
+void* alloc_untracked(size_t size, is_array_t is_array, size_t alignment)
+{
+    uint32_t head_size = align(sizeof(new_ptr_tag_t), alignment);
+    auto ptr = static_cast<char*>(debug_new_alloc(size + head_size,
+                                                  alignment));
+    if (ptr == nullptr) {
+        fast_mutex_autolock lock(new_output_lock);
+        fprintf(new_output_fp,
+                "Out of memory when allocating %zu bytes\n",
+                size);
+        fflush(new_output_fp);
+        return nullptr;
+    }
+    auto usr_ptr = ptr + head_size;
+    auto tag = reinterpret_cast<new_ptr_tag_t*>(usr_ptr) - 1;
+    tag->head_size = head_size;
+    tag->is_array = is_array;
+    tag->magic = DEBUG_NEW_UNTRACKED_MAGIC;
+    return usr_ptr;
+}
+
+/**
+ * Gets the tag of memory that is not tracked in sampling mode.
  *
- * @param ptr  pointer to the memory to deallocate
+ * @param usr_ptr  pointer returned by a new-expression
+ * @return         pointer to the tag if the memory is untracked;
+ *                 \c nullptr otherwise
  */
-void debug_new_free(void* ptr)
+inline new_ptr_tag_t* get_untracked_tag(void* usr_ptr)
 {
-#if NVWA_WIN32
-    _aligned_free(ptr);
-#else
-    free(ptr);
-#endif
+    auto tag = static_cast<new_ptr_tag_t*>(usr_ptr) - 1;
+    if (tag->magic == DEBUG_NEW_UNTRACKED_MAGIC) {
+        return tag;
+    }
+    return nullptr;
 }
 
+void check_mem_corruption_periodically();
+
 /**
  * Allocates memory and initializes control data.
  *
@@ -681,10 +1758,25 @@ void* alloc_mem(size_t size, const char* file, int line,
     if (alignment < _DEBUG_NEW_ALIGNMENT) {
         alignment = _DEBUG_NEW_ALIGNMENT;
     }
+    if (new_sampling_rate != 0 && !should_sample(size)) {
+        return alloc_untracked(size, is_array, alignment);
+    }
 
     uint32_t aligned_list_item_size = align(sizeof(new_ptr_list_t), alignment);
-    size_t s = size + aligned_list_item_size + _DEBUG_NEW_TAILCHECK;
-    auto ptr = static_cast<new_ptr_list_t*>(debug_new_alloc(s, alignment));
+    new_ptr_list_t* ptr = nullptr;
+    bool is_guarded = false;
+#if NVWA_UNIX
+    if (new_guard_page_interval != 0 && should_guard(size, alignment)) {
+        // A memory block without a guard page is used instead if the
+        // mapping fails, say, when the limit of mappings is reached
+        ptr = alloc_guarded(size, aligned_list_item_size, alignment);
+        is_guarded = ptr != nullptr;
+    }
+#endif
+    if (ptr == nullptr) {
+        size_t s = size + aligned_list_item_size + _DEBUG_NEW_TAILCHECK;
+        ptr = static_cast<new_ptr_list_t*>(debug_new_alloc(s, alignment));
+    }
     if (ptr == nullptr) {
         fast_mutex_autolock lock(new_output_lock);
         fprintf(new_output_fp,
@@ -694,6 +1786,12 @@ void* alloc_mem(size_t size, const char* file, int line,
         return nullptr;
     }
     auto usr_ptr = reinterpret_cast<char*>(ptr) + aligned_list_item_size;
+    // Make sure it is not taken for untracked memory: the place may be
+    // padding, or the magic number (set later)
+    static_assert(offsetof(new_ptr_list_t, magic) + sizeof(uint32_t) >=
+                      sizeof(new_ptr_list_t) - sizeof(uint32_t),
+                  "magic should be the last member");
+    (reinterpret_cast<new_ptr_tag_t*>(usr_ptr) - 1)->magic = 0;
 #if _DEBUG_NEW_FILENAME_LEN == 0
     ptr->file = file;
 #else
@@ -706,7 +1804,7 @@ void* alloc_mem(size_t size, const char* file, int line,
 #endif
     ptr->line = line;
 #if _DEBUG_NEW_REMEMBER_STACK_TRACE
-    ptr->stacktrace = nullptr;
+    ptr->stacktrace_id = 0;
 
 #if _DEBUG_NEW_REMEMBER_STACK_TRACE == 2
     if (line == 0)
@@ -724,33 +1822,42 @@ void* alloc_mem(size_t size, const char* file, int line,
             0, DWORD(buffer_length), buffer, nullptr);
 #endif
 
-        size_t stacktrace_size = stacktrace_length * sizeof(void*);
-        ptr->stacktrace =
-            static_cast<void**>(malloc(stacktrace_size + sizeof(void*)));
-
-        if (ptr->stacktrace != nullptr) {
-            memcpy(ptr->stacktrace, buffer, stacktrace_size);
-            ptr->stacktrace[stacktrace_length] = nullptr;
-        }
+        ptr->stacktrace_id = intern_stacktrace(buffer, stacktrace_length);
     }
 #endif
     ptr->is_array = is_array;
+    ptr->is_guarded = is_guarded;
     ptr->size = size;
     ptr->head_size = aligned_list_item_size;
     ptr->magic = DEBUG_NEW_MAGIC;
     {
-        fast_mutex_autolock lock(new_ptr_lock);
-        ptr->prev = new_ptr_list.prev;
-        ptr->next = &new_ptr_list;
-        new_ptr_list.prev->next = ptr;
-        new_ptr_list.prev = ptr;
-        current_mem_alloc += size;
-        ++total_mem_alloc_cnt_accum;
+        size_t index = get_shard_index(ptr);
+        fast_mutex_autolock lock(new_ptr_locks[index].mtx);
+        new_ptr_shard_t& shard = new_ptr_shards[index];
+        new_ptr_list_t* head = get_list_head(shard);
+        ptr->prev = head->prev;
+        ptr->next = head;
+        head->prev->next = ptr;
+        head->prev = ptr;
+        shard.current_mem_alloc += size;
+        ++shard.current_alloc_cnt;
+        ++shard.total_mem_alloc_cnt;
     }
 #if _DEBUG_NEW_TAILCHECK
-    memset(usr_ptr + size, _DEBUG_NEW_TAILCHECK_CHAR, _DEBUG_NEW_TAILCHECK);
+    memset(usr_ptr + size, _DEBUG_NEW_TAILCHECK_CHAR, get_tail_size(ptr));
+#endif
+    if (new_check_interval != 0) {
+        check_mem_corruption_periodically();
+    }
+#if _DEBUG_NEW_TRACE_EVENTS
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    trace_alloc_event(alloc_event_alloc, usr_ptr, size, ptr->stacktrace_id);
+#else
+    trace_alloc_event(alloc_event_alloc, usr_ptr, size, 0);
+#endif
 #endif
     if (new_verbose_flag) {
+        symbolize_position(ptr->addr, ptr->line);
         fast_mutex_autolock lock(new_output_lock);
         fprintf(new_output_fp,
                 "new%s: allocated %p (size %zu, ",
@@ -762,147 +1869,743 @@ void* alloc_mem(size_t size, const char* file, int line,
         }
         fprintf(new_output_fp, ")\n");
     }
-    return usr_ptr;
+    return usr_ptr;
+}
+
+/**
+ * Frees memory and adjusts pointers.
+ *
+ * @param usr_ptr   pointer returned by a new-expression
+ * @param addr      pointer to the caller
+ * @param is_array  flag indicating whether it is invoked by a
+ *                  <code>delete[]</code> call
+ */
+void free_pointer(void* usr_ptr, void* addr, is_array_t is_array,
+                  size_t alignment = _DEBUG_NEW_ALIGNMENT)
+{
+    if (alignment < _DEBUG_NEW_ALIGNMENT) {
+        alignment = _DEBUG_NEW_ALIGNMENT;
+    }
+    if (usr_ptr == nullptr) {
+        return;
+    }
+
+    if (auto tag = get_untracked_tag(usr_ptr)) {
+        if (is_array != tag->is_array) {
+            symbolize_position(addr, 0);
+            fast_mutex_autolock lock(new_output_lock);
+            fprintf(new_output_fp,
+                    "%s: untracked pointer %p\n\tat ",
+                    is_array ? "delete[] after new" : "delete after new[]",
+                    usr_ptr);
+            print_position(addr, 0);
+            fprintf(new_output_fp, "\n");
+            fflush(new_output_fp);
+            _DEBUG_NEW_ERROR_ACTION;
+        }
+        tag->magic = 0;
+        debug_new_free(static_cast<char*>(usr_ptr) - tag->head_size);
+        return;
+    }
+
+    auto ptr = convert_user_ptr(usr_ptr, alignment);
+    if (ptr == nullptr) {
+        symbolize_position(addr, 0);
+        {
+            fast_mutex_autolock lock(new_output_lock);
+            fprintf(new_output_fp, "delete%s: invalid pointer %p (",
+                    is_array ? "[]" : "", usr_ptr);
+            print_position(addr, 0);
+            fprintf(new_output_fp, ")\n");
+        }
+        check_mem_corruption();
+        fflush(new_output_fp);
+        _DEBUG_NEW_ERROR_ACTION;
+    }
+    if (is_array != ptr->is_array) {
+        const char* msg;
+        if (is_array) {
+            msg = "delete[] after new";
+        } else {
+            msg = "delete after new[]";
+        }
+        const void* addrs[] = {addr, ptr->line == 0 ? ptr->addr : nullptr};
+        symbolize_addrs(addrs, 2);
+        fast_mutex_autolock lock(new_output_lock);
+        fprintf(new_output_fp,
+                "%s: pointer %p (size %zu)\n\tat ",
+                msg, usr_ptr, ptr->size);
+        print_position(addr, 0);
+        fprintf(new_output_fp, "\n\toriginally allocated at ");
+        if (ptr->line != 0) {
+            print_position(ptr->file, ptr->line);
+        } else {
+            print_position(ptr->addr, ptr->line);
+        }
+        fprintf(new_output_fp, "\n");
+        fflush(new_output_fp);
+        _DEBUG_NEW_ERROR_ACTION;
+    }
+#if _DEBUG_NEW_TAILCHECK
+    if (!check_tail(ptr)) {
+        check_mem_corruption();
+        fflush(new_output_fp);
+        _DEBUG_NEW_ERROR_ACTION;
+    }
+#endif
+    {
+        size_t index = get_shard_index(ptr);
+        fast_mutex_autolock lock(new_ptr_locks[index].mtx);
+        new_ptr_shard_t& shard = new_ptr_shards[index];
+        shard.current_mem_alloc -= ptr->size;
+        --shard.current_alloc_cnt;
+        if (shard.check_cursor == ptr) {
+            shard.check_cursor = ptr->next;
+        }
+        ptr->magic = 0;
+        ptr->prev->next = ptr->next;
+        ptr->next->prev = ptr->prev;
+    }
+    if (new_verbose_flag) {
+        fast_mutex_autolock lock(new_output_lock);
+        fprintf(new_output_fp,
+                "delete%s: freed %p (size %zu, %zu bytes still allocated)\n",
+                is_array ? "[]" : "", usr_ptr, ptr->size,
+                get_current_mem_alloc());
+    }
+#if _DEBUG_NEW_TRACE_EVENTS
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    trace_alloc_event(alloc_event_free, usr_ptr, ptr->size,
+                      ptr->stacktrace_id);
+#else
+    trace_alloc_event(alloc_event_free, usr_ptr, ptr->size, 0);
+#endif
+#endif
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    release_stacktrace(ptr->stacktrace_id);
+#endif
+#if NVWA_UNIX
+    if (ptr->is_guarded) {
+        free_guarded(ptr);
+        return;
+    }
+#endif
+    debug_new_free(ptr);
+}
+
+/**
+ * Reports a leaked memory block, unless it is whitelisted.  The caller
+ * should hold #new_output_lock.
+ *
+ * @param ptr  pointer to a new_ptr_list_t struct
+ * @return     \c true if the leak is whitelisted; \c false otherwise
+ */
+bool report_leak(new_ptr_list_t* ptr)
+{
+    auto usr_ptr =
+        reinterpret_cast<const char*>(ptr) + ALIGNED_LIST_ITEM_SIZE;
+    if (ptr->magic != DEBUG_NEW_MAGIC) {
+        fprintf(new_output_fp,
+                "warning: heap data corrupt near %p\n",
+                usr_ptr);
+    } else {
+        // Adjust usr_ptr after the basic sanity check
+        usr_ptr = reinterpret_cast<const char*>(ptr) + ptr->head_size;
+    }
+#if _DEBUG_NEW_TAILCHECK
+    if (!check_tail(ptr)) {
+        fprintf(new_output_fp,
+                "warning: overwritten past end of object at %p\n",
+                usr_ptr);
+    }
+#endif
+
+    if (is_leak_whitelisted(ptr)) {
+        return true;
+    }
+
+    fprintf(new_output_fp,
+            "Leaked object at %p (size %zu, ",
+            usr_ptr, ptr->size);
+
+    if (ptr->line != 0) {
+        print_position(ptr->file, ptr->line);
+    } else {
+        print_position(ptr->addr, ptr->line);
+    }
+
+    fprintf(new_output_fp, ")\n");
+
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    if (ptr->stacktrace_id != 0) {
+        print_stacktrace(get_stacktrace(ptr->stacktrace_id));
+    }
+#endif
+    return false;
+}
+
+/**
+ * Checks a memory block for corruption, and reports it if found.  The
+ * caller should hold #new_output_lock.
+ *
+ * @param ptr  pointer to a new_ptr_list_t struct
+ * @return     \c true if the memory block is corrupt; \c false
+ *             otherwise
+ */
+bool report_corruption(new_ptr_list_t* ptr)
+{
+    auto usr_ptr =
+        reinterpret_cast<const char*>(ptr) + ALIGNED_LIST_ITEM_SIZE;
+    if (ptr->magic == DEBUG_NEW_MAGIC
+#if _DEBUG_NEW_TAILCHECK
+        && check_tail(ptr)
+#endif
+    ) {
+        return false;
+    }
+#if _DEBUG_NEW_TAILCHECK
+    if (ptr->magic != DEBUG_NEW_MAGIC) {
+#endif
+        fprintf(new_output_fp,
+                "Heap data corrupt near %p (size %zu, ",
+                usr_ptr, ptr->size);
+#if _DEBUG_NEW_TAILCHECK
+    } else {
+        // Adjust usr_ptr after the basic sanity check
+        usr_ptr = reinterpret_cast<const char*>(ptr) + ptr->head_size;
+        fprintf(new_output_fp,
+                "Overwritten past end of object at %p (size %zu, ",
+                usr_ptr, ptr->size);
+    }
+#endif
+    if (ptr->line != 0) {
+        print_position(ptr->file, ptr->line);
+    } else {
+        print_position(ptr->addr, ptr->line);
+    }
+    fprintf(new_output_fp, ")\n");
+
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    if (ptr->stacktrace_id != 0)
+        print_stacktrace(get_stacktrace(ptr->stacktrace_id));
+#endif
+    return true;
+}
+
+/**
+ * Checks a slice of the memory blocks for corruption, continuing from
+ * where the last check stopped.  The shards are visited in turn, and
+ * each shard is locked only while its blocks are checked.  The caller
+ * should hold #check_lock.
+ *
+ * @param max_blocks  maximum number of memory blocks to check
+ * @return            number of corrupt memory blocks found
+ */
+int check_slice(size_t max_blocks)
+{
+    int corrupt_cnt = 0;
+    size_t shard_cnt = 0;
+    const void* symbolized_addr = nullptr;
+    while (max_blocks > 0 && shard_cnt < _DEBUG_NEW_SHARD_COUNT) {
+        const void* unresolved_addr = nullptr;
+        {
+            fast_mutex_autolock lock_ptr(
+                new_ptr_locks[check_shard_index].mtx);
+            new_ptr_shard_t& shard = new_ptr_shards[check_shard_index];
+            new_ptr_list_t* head = get_list_head(shard);
+            new_ptr_list_t* ptr = shard.check_cursor != nullptr
+                                      ? shard.check_cursor
+                                      : head->next;
+            for (; ptr != head && max_blocks > 0; ptr = ptr->next) {
+                --max_blocks;
+                if (ptr->magic == DEBUG_NEW_MAGIC
+#if _DEBUG_NEW_TAILCHECK
+                    && check_tail(ptr)
+#endif
+                ) {
+                    continue;
+                }
+                if (!is_position_resolved(ptr) &&
+                        ptr->addr != symbolized_addr) {
+                    // Stop here to symbolize the position without the
+                    // lock, and check the memory block again
+                    unresolved_addr = ptr->addr;
+                    ++max_blocks;
+                    break;
+                }
+                fast_mutex_autolock lock_output(new_output_lock);
+                report_corruption(ptr);
+                ++corrupt_cnt;
+            }
+            if (ptr == head) {
+                shard.check_cursor = nullptr;
+                check_shard_index = (check_shard_index + 1) %
+                                    _DEBUG_NEW_SHARD_COUNT;
+                ++shard_cnt;
+            } else {
+                shard.check_cursor = ptr;
+            }
+        }
+        if (unresolved_addr != nullptr) {
+            symbolize_addrs(&unresolved_addr, 1);
+            symbolized_addr = unresolved_addr;
+        }
+    }
+    return corrupt_cnt;
+}
+
+/**
+ * Checks a slice of the memory blocks for corruption every
+ * nvwa#new_check_interval allocations in the current thread.  The
+ * check is skipped if another thread is checking.
+ */
+void check_mem_corruption_periodically()
+{
+    static thread_local size_t alloc_cnt = 0;
+    if (++alloc_cnt < new_check_interval) {
+        return;
+    }
+    alloc_cnt = 0;
+    if (!check_lock.try_lock()) {
+        return;
+    }
+    int corrupt_cnt = check_slice(_DEBUG_NEW_CHECK_SLICE);
+    check_lock.unlock();
+    if (corrupt_cnt > 0) {
+        fflush(new_output_fp);
+        _DEBUG_NEW_ERROR_ACTION;
+    }
+}
+
+/**
+ * Structure to aggregate leaks from the same allocation site.
+ */
+struct leak_site_t {
+    leak_site_t*    next;       ///< Next site in the hash bucket
+    size_t          hash;       ///< Hash value of the site
+#if _DEBUG_NEW_FILENAME_LEN == 0
+    const char*     file;       ///< Pointer to the file name of the caller
+#else
+    char            file[_DEBUG_NEW_FILENAME_LEN]; ///< File name of the caller
+#endif
+    void*           addr;       ///< Address of the caller to \e new
+    int             line;       ///< Line number of the caller; or \c 0
+    uint32_t        stacktrace_id; ///< ID of the stack trace; or \c 0
+    size_t          count;      ///< Number of leaked objects
+    size_t          total_size; ///< Total size of leaked objects
+    size_t          max_size;   ///< Size of the largest leaked object
+    const void*     max_ptr;    ///< Address of the largest leaked object
+};
+
+/**
+ * Number of buckets in the hash table of leak sites.
+ */
+constexpr size_t LEAK_SITE_BUCKET_CNT = 4096;
+
+/**
+ * Finds or creates the site of a leaked object.  The site is keyed by
+ * the file/line, or the caller address if the line is \c 0, and the
+ * stack trace ID.
+ *
+ * @param buckets  the hash table of leak sites
+ * @param ptr      pointer to a new_ptr_list_t struct
+ * @return         pointer to the site; or \c nullptr if memory is
+ *                 insufficient
+ */
+leak_site_t* get_leak_site(leak_site_t** buckets, new_ptr_list_t* ptr)
+{
+    size_t hash = ptr->line;
+    if (ptr->line != 0) {
+        for (const char* p = ptr->file; *p != '\0'; ++p) {
+            hash = (hash ^ static_cast<unsigned char>(*p)) * 16777619U;
+        }
+    } else {
+        hash ^= reinterpret_cast<uintptr_t>(ptr->addr);
+    }
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    uint32_t stacktrace_id = ptr->stacktrace_id;
+#else
+    uint32_t stacktrace_id = 0;
+#endif
+    hash = (hash ^ stacktrace_id) * 16777619U;
+
+    leak_site_t** bucket = &buckets[hash % LEAK_SITE_BUCKET_CNT];
+    for (leak_site_t* site = *bucket; site != nullptr; site = site->next) {
+        if (site->hash == hash && site->line == int(ptr->line) &&
+                site->stacktrace_id == stacktrace_id &&
+                (ptr->line != 0 ? strcmp(site->file, ptr->file) == 0
+                                : site->addr == ptr->addr)) {
+            return site;
+        }
+    }
+#ifdef _DEBUG
+    if (new_leak_site_failure_flag) {
+        return nullptr;
+    }
+#endif
+    auto site = static_cast<leak_site_t*>(calloc(1, sizeof(leak_site_t)));
+    if (site == nullptr) {
+        return nullptr;
+    }
+    site->next = *bucket;
+    site->hash = hash;
+    if (ptr->line != 0) {
+#if _DEBUG_NEW_FILENAME_LEN == 0
+        site->file = ptr->file;
+#else
+        strcpy(site->file, ptr->file);
+#endif
+    } else {
+        site->addr = ptr->addr;
+    }
+    site->line = ptr->line;
+    site->stacktrace_id = stacktrace_id;
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    // Keep the stack trace after the leaked object is freed
+    retain_stacktrace(stacktrace_id);
+#endif
+    *bucket = site;
+    return site;
+}
+
+/**
+ * Compares two leak sites for \e qsort, so that the site with more
+ * leaked bytes goes first.
+ */
+int compare_leak_site(const void* lhs, const void* rhs)
+{
+    auto lhs_site = *static_cast<leak_site_t* const*>(lhs);
+    auto rhs_site = *static_cast<leak_site_t* const*>(rhs);
+    if (lhs_site->total_size != rhs_site->total_size) {
+        return lhs_site->total_size > rhs_site->total_size ? -1 : 1;
+    }
+    return lhs_site->count > rhs_site->count ? -1 :
+           (lhs_site->count < rhs_site->count ? 1 : 0);
+}
+
+/**
+ * Prints a leak site.  The caller should hold #new_output_lock.
+ *
+ * @param site  pointer to the leak site
+ */
+void print_leak_site(const leak_site_t* site)
+{
+    fprintf(new_output_fp,
+            "Leaked %zu object%s (%zu bytes, largest %zu at %p) at ",
+            site->count, site->count == 1 ? "" : "s",
+            site->total_size, site->max_size, site->max_ptr);
+    if (site->line != 0) {
+        print_position(site->file, site->line);
+    } else if (site->addr != nullptr) {
+        print_position(site->addr, 0);
+    } else {
+        fprintf(new_output_fp, "(unaggregated)");
+    }
+    fprintf(new_output_fp, "\n");
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    if (site->stacktrace_id != 0) {
+        print_stacktrace(get_stacktrace(site->stacktrace_id));
+    }
+#endif
 }
 
 /**
- * Frees memory and adjusts pointers.
+ * Checks for memory leaks, and reports them grouped by allocation site.
+ * Leaks are aggregated in one pass over each shard, and the report is
+ * output after the shard locks are released.  Leaks whose sites cannot
+ * be allocated are counted in one "(unaggregated)" site, and the sites
+ * are reported unsorted if memory is insufficient for sorting.
  *
- * @param usr_ptr   pointer returned by a new-expression
- * @param addr      pointer to the caller
- * @param is_array  flag indicating whether it is invoked by a
- *                  <code>delete[]</code> call
+ * @return  zero if no leakage is found; the number of leaks otherwise;
+ *          or \c -1 if memory is insufficient for aggregation
  */
-void free_pointer(void* usr_ptr, void* addr, is_array_t is_array,
-                  size_t alignment = _DEBUG_NEW_ALIGNMENT)
+int check_leaks_aggregated()
 {
-    if (alignment < _DEBUG_NEW_ALIGNMENT) {
-        alignment = _DEBUG_NEW_ALIGNMENT;
+    int leak_cnt = 0;
+    int whitelisted_leak_cnt = 0;
+    int corrupt_cnt = 0;
+    size_t site_cnt = 0;
+    leak_site_t unaggregated_site{};
+    auto buckets = static_cast<leak_site_t**>(
+        calloc(LEAK_SITE_BUCKET_CNT, sizeof(leak_site_t*)));
+    if (buckets == nullptr) {
+        return -1;
     }
-    if (usr_ptr == nullptr) {
-        return;
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        fast_mutex_autolock lock_ptr(new_ptr_locks[i].mtx);
+        new_ptr_list_t* head = get_list_head(new_ptr_shards[i]);
+        for (new_ptr_list_t* ptr = head->next; ptr != head;
+                ptr = ptr->next) {
+            ++leak_cnt;
+            if (ptr->magic != DEBUG_NEW_MAGIC
+#if _DEBUG_NEW_TAILCHECK
+                || !check_tail(ptr)
+#endif
+            ) {
+                ++corrupt_cnt;
+            }
+            if (is_leak_whitelisted(ptr)) {
+                ++whitelisted_leak_cnt;
+                continue;
+            }
+            leak_site_t* site = get_leak_site(buckets, ptr);
+            if (site == nullptr) {
+                site = &unaggregated_site;
+            } else if (site->count == 0) {
+                ++site_cnt;
+            }
+            ++site->count;
+            site->total_size += ptr->size;
+            if (ptr->size >= site->max_size) {
+                site->max_size = ptr->size;
+                site->max_ptr = reinterpret_cast<char*>(ptr) +
+                                ptr->head_size;
+            }
+        }
     }
 
-    auto ptr = convert_user_ptr(usr_ptr, alignment);
-    if (ptr == nullptr) {
-        {
-            fast_mutex_autolock lock(new_output_lock);
-            fprintf(new_output_fp, "delete%s: invalid pointer %p (",
-                    is_array ? "[]" : "", usr_ptr);
-            print_position(addr, 0);
-            fprintf(new_output_fp, ")\n");
+    // Sort the sites, and symbolize their addresses in advance
+    auto sites = static_cast<leak_site_t**>(
+        malloc((site_cnt + 1) * sizeof(leak_site_t*)));
+    auto addrs = static_cast<const void**>(
+        malloc((site_cnt + 1) * sizeof(void*)));
+    size_t addr_cnt = 0;
+    site_cnt = 0;
+    for (size_t i = 0; i < LEAK_SITE_BUCKET_CNT; ++i) {
+        for (leak_site_t* site = buckets[i]; site != nullptr;
+                site = site->next) {
+            if (sites != nullptr) {
+                sites[site_cnt++] = site;
+            }
+            if (addrs != nullptr && site->line == 0 &&
+                    site->addr != nullptr) {
+                addrs[addr_cnt++] = site->addr;
+            }
         }
-        check_mem_corruption();
-        fflush(new_output_fp);
-        _DEBUG_NEW_ERROR_ACTION;
     }
-    if (is_array != ptr->is_array) {
-        const char* msg;
-        if (is_array) {
-            msg = "delete[] after new";
-        } else {
-            msg = "delete after new[]";
+    if (addrs != nullptr) {
+        symbolize_addrs(addrs, addr_cnt);
+        free(addrs);
+    }
+
+    fast_mutex_autolock lock_output(new_output_lock);
+    if (sites != nullptr) {
+        qsort(sites, site_cnt, sizeof(leak_site_t*), compare_leak_site);
+        for (size_t i = 0; i < site_cnt; ++i) {
+            print_leak_site(sites[i]);
         }
-        fast_mutex_autolock lock(new_output_lock);
-        fprintf(new_output_fp,
-                "%s: pointer %p (size %zu)\n\tat ",
-                msg, usr_ptr, ptr->size);
-        print_position(addr, 0);
-        fprintf(new_output_fp, "\n\toriginally allocated at ");
-        if (ptr->line != 0) {
-            print_position(ptr->file, ptr->line);
-        } else {
-            print_position(ptr->addr, ptr->line);
+        free(sites);
+    } else {
+        for (size_t i = 0; i < LEAK_SITE_BUCKET_CNT; ++i) {
+            for (leak_site_t* site = buckets[i]; site != nullptr;
+                    site = site->next) {
+                print_leak_site(site);
+            }
         }
-        fprintf(new_output_fp, "\n");
-        fflush(new_output_fp);
-        _DEBUG_NEW_ERROR_ACTION;
-    }
-#if _DEBUG_NEW_TAILCHECK
-    if (!check_tail(ptr)) {
-        check_mem_corruption();
-        fflush(new_output_fp);
-        _DEBUG_NEW_ERROR_ACTION;
     }
-#endif
-    {
-        fast_mutex_autolock lock(new_ptr_lock);
-        current_mem_alloc -= ptr->size;
-        ptr->magic = 0;
-        ptr->prev->next = ptr->next;
-        ptr->next->prev = ptr->prev;
+    if (unaggregated_site.count > 0) {
+        print_leak_site(&unaggregated_site);
     }
-    if (new_verbose_flag) {
-        fast_mutex_autolock lock(new_output_lock);
+    if (corrupt_cnt > 0) {
         fprintf(new_output_fp,
-                "delete%s: freed %p (size %zu, %zu bytes still allocated)\n",
-                is_array ? "[]" : "", usr_ptr, ptr->size, current_mem_alloc);
+                "warning: %d leaked objects have corrupt heap data\n",
+                corrupt_cnt);
+    }
+    if (new_verbose_flag || leak_cnt) {
+        if (whitelisted_leak_cnt > 0) {
+            fprintf(new_output_fp, "*** %d leaks found (%d whitelisted)\n",
+                leak_cnt, whitelisted_leak_cnt);
+        } else {
+            fprintf(new_output_fp, "*** %d leaks found\n", leak_cnt);
+        }
     }
+
+    for (size_t i = 0; i < LEAK_SITE_BUCKET_CNT; ++i) {
+        leak_site_t* site = buckets[i];
+        while (site != nullptr) {
+            leak_site_t* next = site->next;
 #if _DEBUG_NEW_REMEMBER_STACK_TRACE
-    free(ptr->stacktrace);
+            release_stacktrace(site->stacktrace_id);
 #endif
-    debug_new_free(ptr);
+            free(site);
+            site = next;
+        }
+    }
+    free(buckets);
+    return leak_cnt;
 }
 
-} /* unnamed namespace */
+/**
+ * Structure to store a copy of a memory block header in a snapshot.
+ */
+struct snapshot_item_t {
+    const void*     usr_ptr;    ///< Pointer to the user memory
+    new_ptr_list_t  info;       ///< Copy of the memory block header
+};
 
 /**
- * Checks for memory leaks.
+ * Releases the stack traces referred to by snapshot items.
  *
- * @return  zero if no leakage is found; the number of leaks otherwise
+ * @param items  pointer to the items
+ * @param count  number of the items
  */
-int check_leaks()
+void release_snapshot_items(snapshot_item_t* items, size_t count)
 {
-    int leak_cnt = 0;
-    int whitelisted_leak_cnt = 0;
-    fast_mutex_autolock lock_ptr(new_ptr_lock);
-    fast_mutex_autolock lock_output(new_output_lock);
-    new_ptr_list_t* ptr = new_ptr_list.next;
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    for (size_t i = 0; i < count; ++i) {
+        release_stacktrace(items[i].info.stacktrace_id);
+    }
+#else
+    (void)items;
+    (void)count;
+#endif
+}
 
-    while (ptr != &new_ptr_list) {
-        auto usr_ptr =
-            reinterpret_cast<const char*>(ptr) + ALIGNED_LIST_ITEM_SIZE;
-        if (ptr->magic != DEBUG_NEW_MAGIC) {
-            fprintf(new_output_fp,
-                    "warning: heap data corrupt near %p\n",
-                    usr_ptr);
-        } else {
-            // Adjust usr_ptr after the basic sanity check
-            usr_ptr = reinterpret_cast<const char*>(ptr) + ptr->head_size;
-        }
-#if _DEBUG_NEW_TAILCHECK
-        if (!check_tail(ptr)) {
-            fprintf(new_output_fp,
-                    "warning: overwritten past end of object at %p\n",
-                    usr_ptr);
-        }
+/**
+ * Copies the file name of a memory block for an allocation record.  The
+ * name is copied only if it is stored in the memory block, so that it
+ * outlives the block.
+ *
+ * @param file  the file name
+ * @return      the file name for the record; or \c nullptr if memory is
+ *              insufficient
+ */
+const char* copy_file_name(const char* file)
+{
+#if _DEBUG_NEW_FILENAME_LEN == 0
+    return file;
+#else
+    size_t len = strlen(file) + 1;
+    auto result = static_cast<char*>(malloc(len));
+    if (result != nullptr) {
+        memcpy(result, file, len);
+    }
+    return result;
 #endif
+}
 
-        if (is_leak_whitelisted(ptr)) {
-            ++whitelisted_leak_cnt;
-        } else {
-            fprintf(new_output_fp,
-                    "Leaked object at %p (size %zu, ",
-                    usr_ptr, ptr->size);
+/**
+ * Frees the file name returned by #copy_file_name.
+ *
+ * @param file  the file name; or \c nullptr
+ */
+void free_file_name(const char* file)
+{
+#if _DEBUG_NEW_FILENAME_LEN == 0
+    (void)file;
+#else
+    free(const_cast<char*>(file));
+#endif
+}
 
-            if (ptr->line != 0) {
-                print_position(ptr->file, ptr->line);
-            } else {
-                print_position(ptr->addr, ptr->line);
-            }
+} /* unnamed namespace */
 
-            fprintf(new_output_fp, ")\n");
+/**
+ * Default constructor.  The record refers to nothing.
+ */
+alloc_record::alloc_record() noexcept
+    : usr_ptr(nullptr), size(0), file(nullptr), line(0), addr(nullptr),
+      stacktrace(nullptr), stacktrace_id(0)
+{
+}
 
+/**
+ * Copy constructor.  The file name is copied, and a reference to the
+ * stack trace is added.
+ *
+ * @param rhs  the record to copy
+ */
+alloc_record::alloc_record(const alloc_record& rhs)
+    : usr_ptr(rhs.usr_ptr), size(rhs.size),
+      file(rhs.file != nullptr ? copy_file_name(rhs.file) : nullptr),
+      line(file != nullptr ? rhs.line : 0), addr(rhs.addr),
+      stacktrace(rhs.stacktrace), stacktrace_id(rhs.stacktrace_id)
+{
 #if _DEBUG_NEW_REMEMBER_STACK_TRACE
-            if (ptr->stacktrace != nullptr) {
-                print_stacktrace(ptr->stacktrace);
-            }
+    retain_stacktrace(stacktrace_id);
 #endif
+}
+
+/**
+ * Move constructor.  The file name and the stack trace are taken over.
+ *
+ * @param rhs  the record to move from
+ */
+alloc_record::alloc_record(alloc_record&& rhs) noexcept
+    : usr_ptr(rhs.usr_ptr), size(rhs.size), file(rhs.file),
+      line(rhs.line), addr(rhs.addr), stacktrace(rhs.stacktrace),
+      stacktrace_id(rhs.stacktrace_id)
+{
+    rhs.file = nullptr;
+    rhs.line = 0;
+    rhs.stacktrace = nullptr;
+    rhs.stacktrace_id = 0;
+}
+
+/**
+ * Destructor.  The file name and the reference to the stack trace are
+ * released.
+ */
+alloc_record::~alloc_record()
+{
+    free_file_name(file);
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+    release_stacktrace(stacktrace_id);
+#endif
+}
+
+/**
+ * Assignment operator, for both copying and moving.
+ *
+ * @param rhs  the record to assign from
+ * @return     reference to this record
+ */
+alloc_record& alloc_record::operator=(alloc_record rhs) noexcept
+{
+    std::swap(usr_ptr, rhs.usr_ptr);
+    std::swap(size, rhs.size);
+    std::swap(file, rhs.file);
+    std::swap(line, rhs.line);
+    std::swap(addr, rhs.addr);
+    std::swap(stacktrace, rhs.stacktrace);
+    std::swap(stacktrace_id, rhs.stacktrace_id);
+    return *this;
+}
+
+/**
+ * Checks for memory leaks.  The shards of the pointer list are checked
+ * one by one, so allocations and deallocations in other shards are not
+ * blocked.  Caller addresses are symbolized in advance, before the
+ * report.  If nvwa#new_aggregate_leaks_flag is \c true, leaks are
+ * reported grouped by allocation site.
+ *
+ * @return  zero if no leakage is found; the number of leaks otherwise
+ */
+int check_leaks()
+{
+    if (new_aggregate_leaks_flag) {
+        int leak_cnt = check_leaks_aggregated();
+        if (leak_cnt >= 0) {
+            return leak_cnt;
         }
+    }
 
-        ptr = ptr->next;
-        ++leak_cnt;
+    int leak_cnt = 0;
+    int whitelisted_leak_cnt = 0;
+    symbolize_positions(false);
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        fast_mutex_autolock lock_ptr(new_ptr_locks[i].mtx);
+        fast_mutex_autolock lock_output(new_output_lock);
+        new_ptr_list_t* head = get_list_head(new_ptr_shards[i]);
+        for (new_ptr_list_t* ptr = head->next; ptr != head;
+                ptr = ptr->next) {
+            if (report_leak(ptr)) {
+                ++whitelisted_leak_cnt;
+            }
+            ++leak_cnt;
+        }
     }
+    fast_mutex_autolock lock_output(new_output_lock);
     if (new_verbose_flag || leak_cnt) {
         if (whitelisted_leak_cnt > 0) {
             fprintf(new_output_fp, "*** %d leaks found (%d whitelisted)\n",
@@ -916,7 +2619,9 @@ int check_leaks()
 }
 
 /**
- * Checks for heap corruption.
+ * Checks for heap corruption.  The shards of the pointer list are
+ * checked one by one.  Caller addresses of corrupt memory blocks are
+ * symbolized in advance, before the shards are locked for the report.
  *
  * @return  zero if no problem is found; the number of found memory
  *          corruptions otherwise
@@ -924,55 +2629,46 @@ int check_leaks()
 int check_mem_corruption()
 {
     int corrupt_cnt = 0;
-    fast_mutex_autolock lock_ptr(new_ptr_lock);
-    fast_mutex_autolock lock_output(new_output_lock);
-    fprintf(new_output_fp, "*** Checking for memory corruption: START\n");
-    for (new_ptr_list_t* ptr = new_ptr_list.next;
-            ptr != &new_ptr_list;
-            ptr = ptr->next) {
-        auto usr_ptr =
-            reinterpret_cast<const char*>(ptr) + ALIGNED_LIST_ITEM_SIZE;
-        if (ptr->magic == DEBUG_NEW_MAGIC
-#if _DEBUG_NEW_TAILCHECK
-            && check_tail(ptr)
-#endif
-        ) {
-            continue;
-        }
-#if _DEBUG_NEW_TAILCHECK
-        if (ptr->magic != DEBUG_NEW_MAGIC) {
-#endif
-            fprintf(new_output_fp,
-                    "Heap data corrupt near %p (size %zu, ",
-                    usr_ptr, ptr->size);
-#if _DEBUG_NEW_TAILCHECK
-        } else {
-            // Adjust usr_ptr after the basic sanity check
-            usr_ptr = reinterpret_cast<const char*>(ptr) + ptr->head_size;
-            fprintf(new_output_fp,
-                    "Overwritten past end of object at %p (size %zu, ",
-                    usr_ptr, ptr->size);
-        }
-#endif
-        if (ptr->line != 0) {
-            print_position(ptr->file, ptr->line);
-        } else {
-            print_position(ptr->addr, ptr->line);
+    symbolize_positions(true);
+    {
+        fast_mutex_autolock lock_output(new_output_lock);
+        fprintf(new_output_fp,
+                "*** Checking for memory corruption: START\n");
+    }
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        fast_mutex_autolock lock_ptr(new_ptr_locks[i].mtx);
+        fast_mutex_autolock lock_output(new_output_lock);
+        new_ptr_list_t* head = get_list_head(new_ptr_shards[i]);
+        for (new_ptr_list_t* ptr = head->next; ptr != head;
+                ptr = ptr->next) {
+            if (report_corruption(ptr)) {
+                ++corrupt_cnt;
+            }
         }
-        fprintf(new_output_fp, ")\n");
-
-#if _DEBUG_NEW_REMEMBER_STACK_TRACE
-        if (ptr->stacktrace != nullptr)
-            print_stacktrace(ptr->stacktrace);
-#endif
-
-        ++corrupt_cnt;
     }
+    fast_mutex_autolock lock_output(new_output_lock);
     fprintf(new_output_fp, "*** Checking for memory corruption: %d FOUND\n",
             corrupt_cnt);
     return corrupt_cnt;
 }
 
+/**
+ * Checks a slice of the memory blocks for corruption.  Successive calls
+ * continue from where the last call stopped, even if memory blocks are
+ * allocated and freed in the meantime, so that all memory blocks are
+ * checked in turn without blocking other threads for long.  Corrupt
+ * memory blocks are reported as in nvwa#check_mem_corruption.
+ *
+ * @param max_blocks  maximum number of memory blocks to check
+ * @return            zero if no problem is found; the number of found
+ *                    memory corruptions otherwise
+ */
+int check_mem_corruption_slice(size_t max_blocks)
+{
+    fast_mutex_autolock lock_check(check_lock);
+    return check_slice(max_blocks);
+}
+
 /**
  * Gets the current allocated memory in bytes.
  *
@@ -980,7 +2676,11 @@ int check_mem_corruption()
  */
 size_t get_current_mem_alloc()
 {
-    return current_mem_alloc;
+    size_t result = 0;
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        result += new_ptr_shards[i].current_mem_alloc;
+    }
+    return result;
 }
 
 /**
@@ -990,7 +2690,151 @@ size_t get_current_mem_alloc()
  */
 size_t get_total_mem_alloc_cnt()
 {
-    return total_mem_alloc_cnt_accum;
+    size_t result = 0;
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        result += new_ptr_shards[i].total_mem_alloc_cnt;
+    }
+    return result;
+}
+
+/**
+ * Takes a snapshot of the currently allocated memory blocks.  Only the
+ * block headers are copied when a shard lock is held, and memory for
+ * the copies is reserved beforehand, so allocations and deallocations
+ * in other threads are blocked very briefly.  The snapshot can then be
+ * analysed or printed without blocking them, say, periodically in a
+ * long-running program.
+ *
+ * @return  the snapshot; or an empty snapshot if memory is insufficient
+ */
+alloc_snapshot snapshot_allocations()
+{
+    alloc_snapshot snapshot;
+
+    // The counts are only used as a hint, but still read under the
+    // locks, as they are updated under them
+    size_t capacity = 16;
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        fast_mutex_autolock lock_ptr(new_ptr_locks[i].mtx);
+        capacity += new_ptr_shards[i].current_alloc_cnt;
+    }
+    capacity += capacity / 8;
+    auto items = static_cast<snapshot_item_t*>(
+        malloc(capacity * sizeof(snapshot_item_t)));
+    if (items == nullptr) {
+        return snapshot;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < _DEBUG_NEW_SHARD_COUNT; ++i) {
+        fast_mutex_autolock lock_ptr(new_ptr_locks[i].mtx);
+        new_ptr_shard_t& shard = new_ptr_shards[i];
+        if (count + shard.current_alloc_cnt > capacity) {
+            // Allocations have grown rapidly since the count was read
+            capacity = (count + shard.current_alloc_cnt) * 2;
+            auto new_items = static_cast<snapshot_item_t*>(
+                realloc(items, capacity * sizeof(snapshot_item_t)));
+            if (new_items == nullptr) {
+                release_snapshot_items(items, count);
+                free(items);
+                return snapshot;
+            }
+            items = new_items;
+        }
+        new_ptr_list_t* head = get_list_head(shard);
+        size_t first = count;
+        for (new_ptr_list_t* ptr = head->next; ptr != head;
+                ptr = ptr->next) {
+            snapshot_item_t& item = items[count++];
+            item.usr_ptr = reinterpret_cast<const char*>(ptr) +
+                           (ptr->magic == DEBUG_NEW_MAGIC
+                                ? ptr->head_size
+                                : ALIGNED_LIST_ITEM_SIZE);
+            item.info = *ptr;
+        }
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+        // Keep the stack traces after the memory blocks are freed
+        fast_mutex_autolock lock_stacktrace(stacktrace_lock);
+        for (size_t j = first; j < count; ++j) {
+            uint32_t& id = items[j].info.stacktrace_id;
+            if (stacktrace_entry_t* entry = find_stacktrace(id)) {
+                ++entry->ref_cnt;
+            } else {
+                id = 0;
+            }
+        }
+#else
+        (void)first;
+#endif
+    }
+
+    // The references to the stack traces are handed over to the records
+    snapshot.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const snapshot_item_t& item = items[i];
+        alloc_record record;
+        record.usr_ptr = item.usr_ptr;
+        record.size = item.info.size;
+        if (item.info.line != 0) {
+            record.file = copy_file_name(item.info.file);
+            if (record.file != nullptr) {
+                record.line = item.info.line;
+            }
+        } else {
+            record.addr = item.info.addr;
+        }
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+        record.stacktrace_id = item.info.stacktrace_id;
+        record.stacktrace = get_stacktrace(record.stacktrace_id);
+#endif
+        snapshot.push_back(std::move(record));
+    }
+    free(items);
+    return snapshot;
+}
+
+/**
+ * Prints a snapshot of the allocated memory blocks.  Caller addresses
+ * are symbolized in advance, before printing.
+ *
+ * @param snapshot  the snapshot
+ */
+void print_alloc_snapshot(const alloc_snapshot& snapshot)
+{
+    auto addrs = static_cast<const void**>(
+        malloc((snapshot.size() + 1) * sizeof(void*)));
+    if (addrs != nullptr) {
+        size_t addr_cnt = 0;
+        for (const alloc_record& record : snapshot) {
+            if (record.addr != nullptr) {
+                addrs[addr_cnt++] = record.addr;
+            }
+        }
+        symbolize_unique_addrs(addrs, addr_cnt);
+        free(addrs);
+    }
+
+    size_t total_size = 0;
+    fast_mutex_autolock lock(new_output_lock);
+    for (const alloc_record& record : snapshot) {
+        fprintf(new_output_fp,
+                "Allocated object at %p (size %zu, ",
+                record.usr_ptr, record.size);
+        if (record.line != 0) {
+            print_position(record.file, record.line);
+        } else {
+            print_position(record.addr, 0);
+        }
+        fprintf(new_output_fp, ")\n");
+#if _DEBUG_NEW_REMEMBER_STACK_TRACE
+        if (record.stacktrace != nullptr) {
+            print_stacktrace(record.stacktrace);
+        }
+#endif
+        total_size += record.size;
+    }
+    fprintf(new_output_fp, "*** %zu objects allocated (%zu bytes)\n",
+            snapshot.size(), total_size);
 }
 
 /**
@@ -1002,7 +2846,7 @@ size_t get_total_mem_alloc_cnt()
  */
 void debug_new_recorder::_M_process(void* usr_ptr)
 {
-    if (usr_ptr == nullptr) {
+    if (usr_ptr == nullptr || get_untracked_tag(usr_ptr) != nullptr) {
         return;
     }
 
@@ -1028,8 +2872,8 @@ void debug_new_recorder::_M_process(void* usr_ptr)
 #endif
     ptr->line = _M_line;
 #if _DEBUG_NEW_REMEMBER_STACK_TRACE == 2
-    free(ptr->stacktrace);
-    ptr->stacktrace = nullptr;
+    release_stacktrace(ptr->stacktrace_id);
+    ptr->stacktrace_id = 0;
 #endif
 }
 
@@ -1202,6 +3046,7 @@ void operator delete[](void* ptr, size_t) noexcept
 void operator delete(void* ptr, const char* file, int line) noexcept
 {
     if (new_verbose_flag) {
+        symbolize_position(file, line);
         fast_mutex_autolock lock(new_output_lock);
         fprintf(new_output_fp,
                 "info: exception thrown on initializing object at %p (",
@@ -1222,6 +3067,7 @@ void operator delete(void* ptr, const char* file, int line) noexcept
 void operator delete[](void* ptr, const char* file, int line) noexcept
 {
     if (new_verbose_flag) {
+        symbolize_position(file, line);
         fast_mutex_autolock lock(new_output_lock);
         fprintf(new_output_fp,
                 "info: exception thrown on initializing objects at %p (",
@@ -1343,6 +3189,7 @@ void operator delete(void* ptr, std::align_val_t align_val,
                      const char* file, int line) noexcept
 {
     if (new_verbose_flag) {
+        symbolize_position(file, line);
         fast_mutex_autolock lock(new_output_lock);
         fprintf(new_output_fp,
                 "info: exception thrown on initializing object at %p (",
@@ -1357,6 +3204,7 @@ void operator delete[](void* ptr, std::align_val_t align_val,
                        const char* file, int line) noexcept
 {
     if (new_verbose_flag) {
+        symbolize_position(file, line);
         fast_mutex_autolock lock(new_output_lock);
         fprintf(new_output_fp,
                 "info: exception thrown on initializing objects at %p (",
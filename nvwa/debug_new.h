@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2024 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,7 +31,7 @@
  *
  * Header file for checking leaks caused by unmatched new/delete.
  *
- * @date  2024-05-20
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_DEBUG_NEW_H
@@ -42,10 +42,13 @@
 #endif
 
 #include <new>                  // std::align_val_t
+#include <vector>               // std::vector
 #include <stddef.h>             // size_t
+#include <stdint.h>             // uint32_t
 #include <stdio.h>              // FILE
 #include "_nvwa.h"              // NVWA macros
 #include "c++_features.h"       // NVWA_USES_CXX17
+#include "malloc_allocator.h"   // nvwa::malloc_allocator
 
 #if NVWA_USES_CXX17 && (NVWA_UNIX || NVWA_WIN32)
 #define NVWA_SUPPORTS_ALIGNED_NEW 1
@@ -143,19 +146,61 @@ typedef void (*stacktrace_print_callback_t)(FILE* fp, void** stacktrace);
 typedef bool (*leak_whitelist_callback_t)(char const* file, int line,
                                           void* addr, void** stacktrace);
 
+/**
+ * Record of an allocated memory block in a snapshot.  \a file and
+ * \a addr are mutually exclusive, and \a stacktrace is non-null only
+ * when the stack trace is remembered.  The record owns its copy of the
+ * file name and its reference to the stack trace, so it stays valid
+ * after the memory block is freed.
+ */
+struct alloc_record {
+    const void* usr_ptr;    ///< Pointer to the user memory
+    size_t      size;       ///< Size of the memory block
+    const char* file;       ///< File name of the caller; or null
+    int         line;       ///< Line number of the caller; or \c 0
+    void*       addr;       ///< Address of the caller; or null
+    void**      stacktrace; ///< Stack trace (null-terminated); or null
+    uint32_t    stacktrace_id; ///< ID of the stack trace; or \c 0
+
+    alloc_record() noexcept;
+    alloc_record(const alloc_record& rhs);
+    alloc_record(alloc_record&& rhs) noexcept;
+    ~alloc_record();
+    alloc_record& operator=(alloc_record rhs) noexcept;
+};
+
+/**
+ * Snapshot of the allocated memory blocks, in the same form as that of
+ * memory_trace.  Memory for the snapshot is not tracked.
+ */
+using alloc_snapshot =
+    std::vector<alloc_record, malloc_allocator<alloc_record>>;
+
 /* Prototypes */
 int check_leaks();
 int check_mem_corruption();
+int check_mem_corruption_slice(size_t max_blocks);
 size_t get_current_mem_alloc();
 size_t get_total_mem_alloc_cnt();
+alloc_snapshot snapshot_allocations();
+void print_alloc_snapshot(const alloc_snapshot& snapshot);
 
 /* Control variables */
 extern bool new_autocheck_flag; // default to true: call check_leaks() on exit
 extern bool new_verbose_flag;   // default to false: no verbose information
+extern bool new_aggregate_leaks_flag; // default to false: list every leak
 extern FILE* new_output_fp;     // default to stderr: output to console
 extern const char* new_progname;// default to null; should be assigned argv[0]
+extern size_t new_sampling_rate;// default to 0: track all allocations
+extern size_t new_check_interval;// default to 0: no checks on allocation
+extern size_t new_guard_page_interval; // default to 0: no guard pages
+extern size_t new_guard_page_min_size; // default to 0
+extern size_t new_guard_page_max_size; // default to SIZE_MAX
 extern stacktrace_print_callback_t stacktrace_print_callback;// default to null
 extern leak_whitelist_callback_t leak_whitelist_callback;    // default to null
+#ifdef _DEBUG
+extern bool new_leak_site_failure_flag; // default to false; for testing only
+#endif
 
 /**
  * @def DEBUG_NEW
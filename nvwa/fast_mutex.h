@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2020 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -29,9 +29,10 @@
 /**
  * @file  fast_mutex.h
  *
- * A fast mutex implementation for POSIX, Win32, and modern C++.
+ * A fast mutex implementation for POSIX, Win32, Linux futexes, and
+ * modern C++.
  *
- * @date  2020-09-13
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_FAST_MUTEX_H
@@ -128,6 +129,60 @@
 #   define _FAST_MUTEX_CHECK_INITIALIZATION 1
 # endif
 
+# ifndef NVWA_USE_FUTEX_MUTEX
+/**
+ * Macro to control whether to use the futex-based implementation of
+ * fast_mutex.  Defining it to a non-zero value makes fast_mutex spin
+ * with exponential backoff for a while before sleeping on a futex,
+ * which suits locks held for very short periods.  It works only on
+ * Linux with GCC or Clang, and takes precedence over the other
+ * multi-threaded implementations.
+ */
+#   define NVWA_USE_FUTEX_MUTEX 0
+# endif
+
+# if NVWA_USE_FUTEX_MUTEX != 0 && \
+        (!defined(__linux__) || !defined(__GNUC__))
+#   error "NVWA_USE_FUTEX_MUTEX is only supported on Linux with GCC/Clang"
+# endif
+
+# ifndef _FAST_MUTEX_SPIN_LIMIT
+/**
+ * Macro to control the maximum number of pause instructions in one
+ * round of spinning in the futex-based fast_mutex.  The number is
+ * doubled in each round, starting from one, until it exceeds this
+ * limit; and the thread sleeps on the futex afterwards.
+ */
+#   define _FAST_MUTEX_SPIN_LIMIT 128
+# endif
+
+# ifndef _FAST_MUTEX_PROFILE
+/**
+ * Macro to control whether to collect contention statistics for
+ * fast_mutex.  Defining it to a non-zero value makes fast_mutex a
+ * wrapper of the real implementation, which records the acquisitions,
+ * contended acquisitions, total waiting time, and maximum holding time
+ * for each mutex name or locking call site.  It requires C++11.
+ */
+#   define _FAST_MUTEX_PROFILE 0
+# endif
+
+# if _FAST_MUTEX_PROFILE
+#   define _FAST_MUTEX_IMPL_BEGIN NVWA_NAMESPACE_BEGIN \
+                                  namespace fast_mutex_impl {
+#   define _FAST_MUTEX_IMPL_END   } NVWA_NAMESPACE_END
+#   if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+#     define _FAST_MUTEX_CALLER_FILE __builtin_FILE()
+#     define _FAST_MUTEX_CALLER_LINE __builtin_LINE()
+#   else
+#     define _FAST_MUTEX_CALLER_FILE "(unknown)"
+#     define _FAST_MUTEX_CALLER_LINE 0
+#   endif
+# else
+#   define _FAST_MUTEX_IMPL_BEGIN NVWA_NAMESPACE_BEGIN
+#   define _FAST_MUTEX_IMPL_END   NVWA_NAMESPACE_END
+# endif
+
 # ifdef _DEBUG
 #   include <stdio.h>
 #   include <stdlib.h>
@@ -143,9 +198,150 @@
         ((void)0)
 # endif
 
-# if NVWA_USE_CXX11_MUTEX != 0
-#   include <mutex>
+# if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#   include <intrin.h>
+# endif
 NVWA_NAMESPACE_BEGIN
+    /**
+     * Tells the processor that the current thread is busy-waiting, so
+     * that it may save power and yield resources to its sibling
+     * hyper-thread.  It is used by the spinning mutexes.
+     */
+    inline void fast_mutex_pause()
+    {
+# if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+        _mm_pause();
+# elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+        __builtin_ia32_pause();
+# elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+        __asm__ __volatile__("yield" ::: "memory");
+# elif defined(__GNUC__)
+        __asm__ __volatile__("" ::: "memory");
+# endif
+    }
+NVWA_NAMESPACE_END
+
+# if NVWA_USE_FUTEX_MUTEX != 0 && !defined(NVWA_NOTHREADS)
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+_FAST_MUTEX_IMPL_BEGIN
+    /**
+     * Class for non-reentrant fast mutexes.  This is the implementation
+     * for Linux futexes.  The futex word is \c 0 when unlocked, \c 1
+     * when locked, and \c 2 when locked with possible waiters, so that
+     * an uncontended lock or unlock takes only one atomic operation.
+     */
+    class fast_mutex {
+        int _M_state;
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+        bool _M_initialized;
+#       endif
+#       ifdef _DEBUG
+        bool _M_locked;
+#       endif
+
+    public:
+        fast_mutex()
+            : _M_state(0)
+#       ifdef _DEBUG
+            , _M_locked(false)
+#       endif
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            _M_initialized = true;
+#       endif
+        }
+        ~fast_mutex()
+        {
+            _FAST_MUTEX_ASSERT(!_M_locked, "~fast_mutex(): still locked");
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            _M_initialized = false;
+#       endif
+        }
+        void lock()
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            if (!_M_initialized) {
+                return;
+            }
+#       endif
+            if (!_M_try_acquire()) {
+                _M_lock_slow();
+            }
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(!_M_locked, "lock(): already locked");
+            _M_locked = true;
+#       endif
+        }
+        bool try_lock()
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            if (!_M_initialized) {
+                return true;
+            }
+#       endif
+            if (!_M_try_acquire()) {
+                return false;
+            }
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(!_M_locked, "try_lock(): already locked");
+            _M_locked = true;
+#       endif
+            return true;
+        }
+        void unlock()
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            if (!_M_initialized) {
+                return;
+            }
+#       endif
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(_M_locked, "unlock(): not locked");
+            _M_locked = false;
+#       endif
+            if (__atomic_exchange_n(&_M_state, 0, __ATOMIC_RELEASE) == 2) {
+                ::syscall(SYS_futex, &_M_state, FUTEX_WAKE_PRIVATE, 1,
+                          _NULLPTR, _NULLPTR, 0);
+            }
+        }
+
+    private:
+        bool _M_try_acquire()
+        {
+            int expected = 0;
+            return __atomic_compare_exchange_n(&_M_state, &expected, 1,
+                                               false, __ATOMIC_ACQUIRE,
+                                               __ATOMIC_RELAXED);
+        }
+        void _M_lock_slow()
+        {
+            for (int spin_cnt = 1; spin_cnt <= _FAST_MUTEX_SPIN_LIMIT;
+                    spin_cnt *= 2) {
+                for (int i = 0; i < spin_cnt; ++i) {
+                    fast_mutex_pause();
+                }
+                if (__atomic_load_n(&_M_state, __ATOMIC_RELAXED) == 0 &&
+                        _M_try_acquire()) {
+                    return;
+                }
+            }
+            // Mark the mutex as having waiters before sleeping, so
+            // that the unlocking thread will wake one up
+            while (__atomic_exchange_n(&_M_state, 2, __ATOMIC_ACQUIRE) != 0) {
+                ::syscall(SYS_futex, &_M_state, FUTEX_WAIT_PRIVATE, 2,
+                          _NULLPTR, _NULLPTR, 0);
+            }
+        }
+
+        fast_mutex(const fast_mutex&) _DELETED;
+        fast_mutex& operator=(const fast_mutex&) _DELETED;
+    };
+_FAST_MUTEX_IMPL_END
+# elif NVWA_USE_CXX11_MUTEX != 0
+#   include <mutex>
+_FAST_MUTEX_IMPL_BEGIN
     /**
      * Class for non-reentrant fast mutexes.  This is the implementation
      * using the C++11 mutex.
@@ -189,6 +385,22 @@ NVWA_NAMESPACE_BEGIN
             _M_locked = true;
 #       endif
         }
+        bool try_lock()
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            if (!_M_initialized) {
+                return true;
+            }
+#       endif
+            if (!_M_mtx_impl.try_lock()) {
+                return false;
+            }
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(!_M_locked, "try_lock(): already locked");
+            _M_locked = true;
+#       endif
+            return true;
+        }
         void unlock()
         {
 #       if _FAST_MUTEX_CHECK_INITIALIZATION
@@ -207,10 +419,10 @@ NVWA_NAMESPACE_BEGIN
         fast_mutex(const fast_mutex&) _DELETED;
         fast_mutex& operator=(const fast_mutex&) _DELETED;
     };
-NVWA_NAMESPACE_END
+_FAST_MUTEX_IMPL_END
 # elif defined(NVWA_PTHREADS)
 #   include <pthread.h>
-NVWA_NAMESPACE_BEGIN
+_FAST_MUTEX_IMPL_BEGIN
     /**
      * Class for non-reentrant fast mutexes.  This is the implementation
      * for POSIX threads.
@@ -261,6 +473,22 @@ NVWA_NAMESPACE_BEGIN
             _M_locked = true;
 #       endif
         }
+        bool try_lock()
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            if (!_M_initialized) {
+                return true;
+            }
+#       endif
+            if (::pthread_mutex_trylock(&_M_mtx_impl) != 0) {
+                return false;
+            }
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(!_M_locked, "try_lock(): already locked");
+            _M_locked = true;
+#       endif
+            return true;
+        }
         void unlock()
         {
 #       if _FAST_MUTEX_CHECK_INITIALIZATION
@@ -279,13 +507,13 @@ NVWA_NAMESPACE_BEGIN
         fast_mutex(const fast_mutex&) _DELETED;
         fast_mutex& operator=(const fast_mutex&) _DELETED;
     };
-NVWA_NAMESPACE_END
+_FAST_MUTEX_IMPL_END
 # elif defined(NVWA_WIN32THREADS)
 #   ifndef WIN32_LEAN_AND_MEAN
 #     define WIN32_LEAN_AND_MEAN
 #   endif /* WIN32_LEAN_AND_MEAN */
 #   include <windows.h>
-NVWA_NAMESPACE_BEGIN
+_FAST_MUTEX_IMPL_BEGIN
     /**
      * Class for non-reentrant fast mutexes.  This is the implementation
      * for Win32 threads.
@@ -331,6 +559,22 @@ NVWA_NAMESPACE_BEGIN
             _M_locked = true;
 #       endif
         }
+        bool try_lock()
+        {
+#       if _FAST_MUTEX_CHECK_INITIALIZATION
+            if (!_M_initialized) {
+                return true;
+            }
+#       endif
+            if (!::TryEnterCriticalSection(&_M_mtx_impl)) {
+                return false;
+            }
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(!_M_locked, "try_lock(): already locked");
+            _M_locked = true;
+#       endif
+            return true;
+        }
         void unlock()
         {
 #       if _FAST_MUTEX_CHECK_INITIALIZATION
@@ -349,9 +593,9 @@ NVWA_NAMESPACE_BEGIN
         fast_mutex(const fast_mutex&) _DELETED;
         fast_mutex& operator=(const fast_mutex&) _DELETED;
     };
-NVWA_NAMESPACE_END
+_FAST_MUTEX_IMPL_END
 # elif defined(NVWA_NOTHREADS)
-NVWA_NAMESPACE_BEGIN
+_FAST_MUTEX_IMPL_BEGIN
     /**
      * Class for non-reentrant fast mutexes.  This is the null
      * implementation for single-threaded environments.
@@ -379,6 +623,14 @@ NVWA_NAMESPACE_BEGIN
             _M_locked = true;
 #       endif
         }
+        bool try_lock()
+        {
+#       ifdef _DEBUG
+            _FAST_MUTEX_ASSERT(!_M_locked, "try_lock(): already locked");
+            _M_locked = true;
+#       endif
+            return true;
+        }
         void unlock()
         {
 #       ifdef _DEBUG
@@ -391,19 +643,332 @@ NVWA_NAMESPACE_BEGIN
         fast_mutex(const fast_mutex&) _DELETED;
         fast_mutex& operator=(const fast_mutex&) _DELETED;
     };
-NVWA_NAMESPACE_END
+_FAST_MUTEX_IMPL_END
 # endif // Definition of class fast_mutex
 
+# if _FAST_MUTEX_PROFILE
+#   include <algorithm>
+#   include <atomic>
+#   include <chrono>
+#   include <new>
+#   include <stdint.h>
+#   include <stdio.h>
+#   include <stdlib.h>
+#   include <string.h>
+NVWA_NAMESPACE_BEGIN
+    /**
+     * Contention statistics of a mutex name or a locking call site.
+     * They are updated with relaxed atomic operations, as mutexes
+     * sharing a name may be locked concurrently.
+     */
+    struct fast_mutex_stats {
+        const char* name;       ///< Mutex name or file name of call site
+        int line;               ///< Line number of call site; or \c 0
+        std::atomic<uint64_t> acquire_cnt;   ///< Acquisitions
+        std::atomic<uint64_t> contended_cnt; ///< Acquisitions that waited
+        std::atomic<uint64_t> wait_ns;       ///< Total waiting time
+        std::atomic<uint64_t> max_hold_ns;   ///< Maximum holding time
+
+        fast_mutex_stats(const char* name_, int line_)
+            : name(name_), line(line_), acquire_cnt(0), contended_cnt(0),
+              wait_ns(0), max_hold_ns(0)
+        {
+        }
+    };
+
+namespace fast_mutex_impl {
+    /** Base-2 logarithm of the size of the table of statistics records. */
+    const int stats_table_bits = 12;
+    /** Size of the table of statistics records. */
+    const size_t stats_table_size = size_t(1) << stats_table_bits;
+
+    inline uint64_t get_time_ns()
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+    }
+
+    inline fast_mutex& get_stats_lock()
+    {
+        static fast_mutex mtx;
+        return mtx;
+    }
+
+    inline std::atomic<fast_mutex_stats*>* get_stats_table()
+    {
+        static std::atomic<fast_mutex_stats*> table[stats_table_size];
+        return table;
+    }
+
+    /**
+     * Gets the statistics record of a mutex name or a call site,
+     * creating it if it does not exist.  Records are keyed by the
+     * address of the name, and are never freed.  Lookup is lock-free,
+     * and only insertion takes a lock.
+     *
+     * @param name  mutex name or file name of the call site
+     * @param line  line number of the call site; or \c 0
+     * @return      pointer to the record
+     */
+    inline fast_mutex_stats* get_stats(const char* name, int line)
+    {
+        static fast_mutex_stats overflow_stats("(other)", 0);
+        std::atomic<fast_mutex_stats*>* table = get_stats_table();
+        // Take the high bits of a multiplicative hash, as the low bits
+        // vary little among the clustered addresses of file names
+        uint64_t key = static_cast<uint64_t>(
+                           reinterpret_cast<uintptr_t>(name) >> 3) * 31 +
+                       static_cast<uint64_t>(line);
+        size_t start = static_cast<size_t>(
+            (key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - stats_table_bits));
+        bool locked = false;
+        for (;;) {
+            size_t i = start;
+            for (size_t n = 0; n < stats_table_size; ++n) {
+                fast_mutex_stats* stats =
+                    table[i].load(std::memory_order_acquire);
+                if (stats == _NULLPTR) {
+                    if (!locked) {
+                        break;
+                    }
+                    void* ptr = malloc(sizeof(fast_mutex_stats));
+                    if (ptr == _NULLPTR) {
+                        break;
+                    }
+                    stats = ::new (ptr) fast_mutex_stats(name, line);
+                    table[i].store(stats, std::memory_order_release);
+                    get_stats_lock().unlock();
+                    return stats;
+                }
+                if (stats->name == name && stats->line == line) {
+                    if (locked) {
+                        get_stats_lock().unlock();
+                    }
+                    return stats;
+                }
+                i = (i + 1) % stats_table_size;
+            }
+            if (locked) {
+                get_stats_lock().unlock();
+                return &overflow_stats;
+            }
+            get_stats_lock().lock();
+            locked = true;
+        }
+    }
+} // namespace fast_mutex_impl
+
+    /**
+     * Class for non-reentrant fast mutexes.  This is the instrumented
+     * wrapper of the real implementation for contention profiling.  A
+     * mutex with a name has its statistics recorded under the name;
+     * otherwise each acquisition is recorded under its call site.
+     */
+    class fast_mutex {
+        fast_mutex_impl::fast_mutex _M_mtx_impl;
+        fast_mutex_stats* _M_named_stats;
+        fast_mutex_stats* _M_holder_stats;
+        uint64_t _M_acquire_time;
+
+    public:
+        fast_mutex() : _M_named_stats(_NULLPTR) {}
+        explicit fast_mutex(const char* name)
+            : _M_named_stats(fast_mutex_impl::get_stats(name, 0))
+        {
+        }
+        void set_name(const char* name)
+        {
+            _M_named_stats = fast_mutex_impl::get_stats(name, 0);
+        }
+        void lock(const char* file = _FAST_MUTEX_CALLER_FILE,
+                  int line = _FAST_MUTEX_CALLER_LINE)
+        {
+            if (_M_mtx_impl.try_lock()) {
+                _M_record_acquisition(file, line, 0);
+                return;
+            }
+            uint64_t wait_start = fast_mutex_impl::get_time_ns();
+            _M_mtx_impl.lock();
+            _M_record_acquisition(file, line, wait_start);
+        }
+        bool try_lock(const char* file = _FAST_MUTEX_CALLER_FILE,
+                      int line = _FAST_MUTEX_CALLER_LINE)
+        {
+            if (!_M_mtx_impl.try_lock()) {
+                return false;
+            }
+            _M_record_acquisition(file, line, 0);
+            return true;
+        }
+        void unlock()
+        {
+            uint64_t hold_ns =
+                fast_mutex_impl::get_time_ns() - _M_acquire_time;
+            std::atomic<uint64_t>& max_hold_ns =
+                _M_holder_stats->max_hold_ns;
+            uint64_t old_max = max_hold_ns.load(std::memory_order_relaxed);
+            while (hold_ns > old_max &&
+                   !max_hold_ns.compare_exchange_weak(
+                       old_max, hold_ns, std::memory_order_relaxed)) {
+            }
+            _M_mtx_impl.unlock();
+        }
+
+    private:
+        void _M_record_acquisition(const char* file, int line,
+                                   uint64_t wait_start)
+        {
+            _M_acquire_time = fast_mutex_impl::get_time_ns();
+            fast_mutex_stats* stats = _M_named_stats;
+            if (stats == _NULLPTR) {
+                stats = fast_mutex_impl::get_stats(file, line);
+            }
+            stats->acquire_cnt.fetch_add(1, std::memory_order_relaxed);
+            if (wait_start != 0) {
+                stats->contended_cnt.fetch_add(1, std::memory_order_relaxed);
+                stats->wait_ns.fetch_add(_M_acquire_time - wait_start,
+                                         std::memory_order_relaxed);
+            }
+            _M_holder_stats = stats;
+        }
+
+        fast_mutex(const fast_mutex&) _DELETED;
+        fast_mutex& operator=(const fast_mutex&) _DELETED;
+    };
+
+namespace fast_mutex_impl {
+    /**
+     * Locks a mutex, passing the call site to it if it is a fast_mutex.
+     * Lock wrappers use it so that the statistics are recorded under
+     * the call sites of the wrappers.
+     */
+    template <class _Mutex>
+    inline void lock_at(_Mutex& mtx, const char*, int)
+    {
+        mtx.lock();
+    }
+    inline void lock_at(NVWA::fast_mutex& mtx, const char* file,
+                        int line)
+    {
+        mtx.lock(file, line);
+    }
+
+    /** Tries to lock a mutex, passing the call site like lock_at. */
+    template <class _Mutex>
+    inline bool try_lock_at(_Mutex& mtx, const char*, int)
+    {
+        return mtx.try_lock();
+    }
+    inline bool try_lock_at(NVWA::fast_mutex& mtx, const char* file,
+                            int line)
+    {
+        return mtx.try_lock(file, line);
+    }
+} // namespace fast_mutex_impl
+
+    /**
+     * Prints the mutex names and call sites with the longest total
+     * waiting time.  Records with the same name and line number are
+     * merged.
+     *
+     * @param fp           the output stream
+     * @param max_entries  maximum number of entries to print
+     */
+    inline void print_fast_mutex_profile(FILE* fp = stderr,
+                                         size_t max_entries = 20)
+    {
+        struct entry_t {
+            const char* name;
+            int line;
+            uint64_t acquire_cnt;
+            uint64_t contended_cnt;
+            uint64_t wait_ns;
+            uint64_t max_hold_ns;
+        };
+        using fast_mutex_impl::stats_table_size;
+        auto entries = static_cast<entry_t*>(
+            malloc(stats_table_size * sizeof(entry_t)));
+        if (entries == _NULLPTR) {
+            return;
+        }
+        size_t entry_cnt = 0;
+        std::atomic<fast_mutex_stats*>* table =
+            fast_mutex_impl::get_stats_table();
+        for (size_t i = 0; i < stats_table_size; ++i) {
+            fast_mutex_stats* stats =
+                table[i].load(std::memory_order_acquire);
+            if (stats == _NULLPTR) {
+                continue;
+            }
+            size_t j = 0;
+            while (j < entry_cnt && (entries[j].line != stats->line ||
+                                     strcmp(entries[j].name,
+                                            stats->name) != 0)) {
+                ++j;
+            }
+            if (j == entry_cnt) {
+                entries[j] = {stats->name, stats->line, 0, 0, 0, 0};
+                ++entry_cnt;
+            }
+            entries[j].acquire_cnt +=
+                stats->acquire_cnt.load(std::memory_order_relaxed);
+            entries[j].contended_cnt +=
+                stats->contended_cnt.load(std::memory_order_relaxed);
+            entries[j].wait_ns +=
+                stats->wait_ns.load(std::memory_order_relaxed);
+            entries[j].max_hold_ns = std::max(
+                entries[j].max_hold_ns,
+                stats->max_hold_ns.load(std::memory_order_relaxed));
+        }
+        std::sort(entries, entries + entry_cnt,
+                  [](const entry_t& lhs, const entry_t& rhs) {
+                      return lhs.wait_ns > rhs.wait_ns;
+                  });
+        fprintf(fp, "%12s %12s %8s %14s %12s  %s\n", "Acquired",
+                "Contended", "Rate", "Wait (ns)", "Max hold", "Mutex");
+        for (size_t i = 0; i < entry_cnt && i < max_entries; ++i) {
+            const entry_t& entry = entries[i];
+            fprintf(fp, "%12llu %12llu %7.2f%% %14llu %12llu  %s",
+                    static_cast<unsigned long long>(entry.acquire_cnt),
+                    static_cast<unsigned long long>(entry.contended_cnt),
+                    entry.acquire_cnt == 0
+                        ? 0.0
+                        : 100.0 * entry.contended_cnt / entry.acquire_cnt,
+                    static_cast<unsigned long long>(entry.wait_ns),
+                    static_cast<unsigned long long>(entry.max_hold_ns),
+                    entry.name);
+            if (entry.line != 0) {
+                fprintf(fp, ":%d", entry.line);
+            }
+            fprintf(fp, "\n");
+        }
+        free(entries);
+    }
+NVWA_NAMESPACE_END
+# endif // _FAST_MUTEX_PROFILE
+
 NVWA_NAMESPACE_BEGIN
 /** RAII lock class for fast_mutex. */
 class fast_mutex_autolock {
     fast_mutex& _M_mtx;
 
 public:
+# if _FAST_MUTEX_PROFILE
+    explicit fast_mutex_autolock(fast_mutex& mtx,
+                                 const char* file = _FAST_MUTEX_CALLER_FILE,
+                                 int line = _FAST_MUTEX_CALLER_LINE)
+        : _M_mtx(mtx)
+    {
+        _M_mtx.lock(file, line);
+    }
+# else
     explicit fast_mutex_autolock(fast_mutex& mtx) : _M_mtx(mtx)
     {
         _M_mtx.lock();
     }
+# endif
     ~fast_mutex_autolock()
     {
         _M_mtx.unlock();
@@ -0,0 +1,156 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+/**
+ * @file  fast_shared_mutex.h
+ *
+ * A reader-writer mutex for read-mostly data, built upon fast_mutex.
+ * The current code requires a C++11-compliant compiler.
+ *
+ * @date  2026-10-16
+ */
+
+#ifndef NVWA_FAST_SHARED_MUTEX_H
+#define NVWA_FAST_SHARED_MUTEX_H
+
+#include "fast_mutex.h"         // nvwa::fast_mutex/_NOTHREADS
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+
+# ifndef _FAST_SHARED_MUTEX_SLOTS
+/**
+ * Macro to control the number of reader slots in a fast_shared_mutex.
+ * Readers in different slots do not contend with one another, so it
+ * should not be smaller than the number of cores that read
+ * simultaneously; but each slot takes a cache line, and a writer needs
+ * to lock all of them.
+ */
+#   define _FAST_SHARED_MUTEX_SLOTS 16
+# endif
+
+# ifdef _NOTHREADS
+NVWA_NAMESPACE_BEGIN
+    /**
+     * Class for non-reentrant reader-writer mutexes.  This is the null
+     * implementation for single-threaded environments.
+     */
+    class fast_shared_mutex {
+    public:
+        fast_shared_mutex() {}
+        void lock() {}
+        bool try_lock() { return true; }
+        void unlock() {}
+        void lock_shared() {}
+        bool try_lock_shared() { return true; }
+        void unlock_shared() {}
+
+    private:
+        fast_shared_mutex(const fast_shared_mutex&) _DELETED;
+        fast_shared_mutex& operator=(const fast_shared_mutex&) _DELETED;
+    };
+NVWA_NAMESPACE_END
+# else
+#   include <atomic>
+NVWA_NAMESPACE_BEGIN
+    /**
+     * Class for non-reentrant reader-writer mutexes.  It is a
+     * big-reader %lock: each thread is assigned one of the
+     * cache-line-padded reader slots, and a reader locks only its own
+     * slot, while a writer locks all slots.  Readers thus do not write
+     * to shared cache lines, and scale with the number of cores, at the
+     * cost of making writing expensive.  It suits data that is read
+     * very often but written rarely.
+     */
+    class fast_shared_mutex {
+        struct alignas(64) reader_slot {
+            fast_mutex mtx;
+        };
+
+        reader_slot _M_slots[_FAST_SHARED_MUTEX_SLOTS];
+
+    public:
+        fast_shared_mutex() {}
+        void lock()
+        {
+            for (unsigned i = 0; i < _FAST_SHARED_MUTEX_SLOTS; ++i) {
+                _M_slots[i].mtx.lock();
+            }
+        }
+        bool try_lock()
+        {
+            for (unsigned i = 0; i < _FAST_SHARED_MUTEX_SLOTS; ++i) {
+                if (!_M_slots[i].mtx.try_lock()) {
+                    while (i > 0) {
+                        _M_slots[--i].mtx.unlock();
+                    }
+                    return false;
+                }
+            }
+            return true;
+        }
+        void unlock()
+        {
+            for (unsigned i = _FAST_SHARED_MUTEX_SLOTS; i > 0; --i) {
+                _M_slots[i - 1].mtx.unlock();
+            }
+        }
+        void lock_shared()
+        {
+            _M_slots[_S_get_slot_index()].mtx.lock();
+        }
+        bool try_lock_shared()
+        {
+            return _M_slots[_S_get_slot_index()].mtx.try_lock();
+        }
+        void unlock_shared()
+        {
+            _M_slots[_S_get_slot_index()].mtx.unlock();
+        }
+
+    private:
+        /**
+         * Gets the reader slot index of the current thread.  Threads are
+         * assigned slots in a round-robin way on first use.
+         *
+         * @return  the slot index
+         */
+        static unsigned _S_get_slot_index()
+        {
+            static std::atomic<unsigned> next_index{0};
+            static thread_local unsigned index =
+                next_index.fetch_add(1, std::memory_order_relaxed) %
+                _FAST_SHARED_MUTEX_SLOTS;
+            return index;
+        }
+
+        fast_shared_mutex(const fast_shared_mutex&) _DELETED;
+        fast_shared_mutex& operator=(const fast_shared_mutex&) _DELETED;
+    };
+NVWA_NAMESPACE_END
+# endif // _NOTHREADS
+
+#endif // NVWA_FAST_SHARED_MUTEX_H
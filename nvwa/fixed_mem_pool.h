@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2005-2024 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2005-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -40,6 +40,10 @@
  *   at the end of the class (say, \c class \e _Cls) definitions.
  * - Optionally, specialize fixed_mem_pool::alignment to change the
  *   alignment value for this specific type.
+ * - Optionally, specialize fixed_mem_pool::growable to make the memory
+ *   pool grow when all memory blocks are allocated.
+ * - Optionally, specialize fixed_mem_pool::backing to change how memory
+ *   is obtained from the system (say, in huge pages).
  * - Optionally, specialize fixed_mem_pool::bad_alloc_handler to change
  *   the behaviour when all memory blocks are allocated.
  * - Call fixed_mem_pool<_Cls>::initialize at the beginning of the
@@ -49,7 +53,7 @@
  * - Optionally, call fixed_mem_pool<_Cls>::get_alloc_count to check
  *   memory usage when the program is running.
  *
- * @date  2024-05-20
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_FIXED_MEM_POOL_H
@@ -77,6 +81,11 @@ NVWA_NAMESPACE_BEGIN
  * Class template to manipulate a fixed-size memory pool.  Please notice
  * that only allocate and deallocate are protected by a lock.
  *
+ * The memory is organized as a chain of segments.  There is only one
+ * segment unless the memory pool is growable, in which case a new
+ * segment as big as all existing ones is added when the memory pool is
+ * exhausted.
+ *
  * @param _Tp  class to use the fixed_mem_pool
  */
 template <class _Tp>
@@ -99,23 +108,59 @@ public:
             (sizeof(_Tp) + fixed_mem_pool<_Tp>::alignment::value - 1)
                        & ~(fixed_mem_pool<_Tp>::alignment::value - 1);
     };
+    /**
+     * Specializable struct to define whether the fixed_mem_pool grows
+     * when all memory blocks are allocated.
+     */
+    struct growable {
+        static const bool value = false;
+    };
+    /**
+     * Specializable struct to define the backing policy to allocate
+     * segments from the system.
+     *
+     * @see nvwa#sys_backing
+     * @see nvwa#huge_page_backing
+     * @see nvwa#numa_local_backing
+     */
+    struct backing {
+        typedef sys_backing type;
+    };
     static void*  allocate();
     static void   deallocate(void* block_ptr);
     static bool   initialize(size_t size);
     static int    deinitialize();
     static int    get_alloc_count();
+    static size_t get_capacity();
     static bool   is_initialized();
 protected:
     static bool   bad_alloc_handler();
 private:
-    static void*  _S_mem_pool_ptr;
+    /** Header of a segment. */
+    struct _Segment {
+        _Segment* _M_next;      ///< Pointer to the next segment
+        size_t    _M_size;      ///< Size of the segment in bytes
+    };
+    /**
+     * Struct to calculate the size of the segment header, which keeps
+     * the memory blocks aligned.
+     */
+    struct header_size {
+        static const size_t value =
+            (sizeof(_Segment) + fixed_mem_pool<_Tp>::alignment::value - 1)
+                       & ~(fixed_mem_pool<_Tp>::alignment::value - 1);
+    };
+    static bool   _S_add_segment(size_t size);
+    static _Segment* _S_mem_pool_ptr;
     static void*  _S_first_avail_ptr;
     static int    _S_alloc_cnt;
+    static size_t _S_capacity;
 };
 
-/** Pointer to the allocated chunk of memory. */
+/** Pointer to the most recently allocated segment of memory. */
 template <class _Tp>
-void* fixed_mem_pool<_Tp>::_S_mem_pool_ptr = _NULLPTR;
+typename fixed_mem_pool<_Tp>::_Segment*
+      fixed_mem_pool<_Tp>::_S_mem_pool_ptr = _NULLPTR;
 
 /** Pointer to the first available memory block. */
 template <class _Tp>
@@ -125,6 +170,10 @@ void* fixed_mem_pool<_Tp>::_S_first_avail_ptr = _NULLPTR;
 template <class _Tp>
 int   fixed_mem_pool<_Tp>::_S_alloc_cnt = 0;
 
+/** Total number of memory blocks in all segments. */
+template <class _Tp>
+size_t fixed_mem_pool<_Tp>::_S_capacity = 0;
+
 /**
  * Allocates a memory block from the memory pool.
  *
@@ -139,6 +188,9 @@ inline void* fixed_mem_pool<_Tp>::allocate()
             _S_first_avail_ptr = *(void**)_S_first_avail_ptr;
             ++_S_alloc_cnt;
             return result;
+        } else if (growable::value && is_initialized() &&
+                   _S_add_segment(_S_capacity)) {
+            continue;
         } else if (!bad_alloc_handler()) {
             return _NULLPTR;
         }
@@ -166,7 +218,8 @@ inline void fixed_mem_pool<_Tp>::deallocate(void* block_ptr)
 /**
  * Initializes the memory pool.
  *
- * @param size  number of memory blocks to put in the memory pool
+ * @param size  number of memory blocks to put in the memory pool (in
+ *              the first segment, if the memory pool is growable)
  * @return      \c true if successful; \c false if memory insufficient
  */
 template <class _Tp>
@@ -180,19 +233,7 @@ bool fixed_mem_pool<_Tp>::initialize(size_t size)
                   Alignment_too_small);
     assert(!is_initialized());
     assert(size > 0);
-    _S_mem_pool_ptr = mem_pool_base::alloc_sys(size * block_size::value);
-    _S_first_avail_ptr = _S_mem_pool_ptr;
-    if (_S_mem_pool_ptr == _NULLPTR) {
-        return false;
-    }
-    char* block = (char*)_S_mem_pool_ptr;
-    while (--size != 0) {
-        char* next = block + block_size::value;
-        *reinterpret_cast<void**>(block) = next;
-        block = next;
-    }
-    *reinterpret_cast<void**>(block) = _NULLPTR;
-    return true;
+    return _S_add_segment(size);
 }
 
 /**
@@ -209,9 +250,14 @@ int fixed_mem_pool<_Tp>::deinitialize()
         return _S_alloc_cnt;
     }
     assert(is_initialized());
-    mem_pool_base::dealloc_sys(_S_mem_pool_ptr);
-    _S_mem_pool_ptr = _NULLPTR;
+    while (_S_mem_pool_ptr != _NULLPTR) {
+        _Segment* next = _S_mem_pool_ptr->_M_next;
+        backing::type::deallocate(_S_mem_pool_ptr,
+                                  _S_mem_pool_ptr->_M_size);
+        _S_mem_pool_ptr = next;
+    }
     _S_first_avail_ptr = _NULLPTR;
+    _S_capacity = 0;
     return 0;
 }
 
@@ -226,6 +272,17 @@ inline int fixed_mem_pool<_Tp>::get_alloc_count()
     return _S_alloc_cnt;
 }
 
+/**
+ * Gets the capacity of the memory pool.
+ *
+ * @return  the total number of memory blocks in the memory pool
+ */
+template <class _Tp>
+inline size_t fixed_mem_pool<_Tp>::get_capacity()
+{
+    return _S_capacity;
+}
+
 /**
  * Is the memory pool initialized?
  *
@@ -251,6 +308,40 @@ bool fixed_mem_pool<_Tp>::bad_alloc_handler()
     return false;
 }
 
+/**
+ * Allocates a new segment from the system, and puts all its memory
+ * blocks into the free list.  The free list must be empty when this
+ * function is called.
+ *
+ * @param size  number of memory blocks in the new segment
+ * @return      \c true if successful; \c false if memory insufficient
+ */
+template <class _Tp>
+bool fixed_mem_pool<_Tp>::_S_add_segment(size_t size)
+{
+    assert(_S_first_avail_ptr == _NULLPTR);
+    size_t segment_size = header_size::value + size * block_size::value;
+    _Segment* segment_ptr =
+        static_cast<_Segment*>(backing::type::allocate(segment_size));
+    if (segment_ptr == _NULLPTR) {
+        return false;
+    }
+    segment_ptr->_M_next = _S_mem_pool_ptr;
+    segment_ptr->_M_size = segment_size;
+    _S_mem_pool_ptr = segment_ptr;
+    _S_capacity += size;
+
+    char* block = (char*)segment_ptr + header_size::value;
+    _S_first_avail_ptr = block;
+    while (--size != 0) {
+        char* next = block + block_size::value;
+        *reinterpret_cast<void**>(block) = next;
+        block = next;
+    }
+    *reinterpret_cast<void**>(block) = _NULLPTR;
+    return true;
+}
+
 NVWA_NAMESPACE_END
 
 /**
@@ -267,6 +358,7 @@ public: \
     static void* operator new(size_t size) \
     { \
         assert(size == sizeof(_Cls)); \
+        (void)size; \
         if (void* ptr = NVWA::fixed_mem_pool<_Cls>::allocate()) { \
             return ptr; \
         } else { \
@@ -290,6 +382,7 @@ public: \
     static void* operator new(size_t size) _NOEXCEPT \
     { \
         assert(size == sizeof(_Cls)); \
+        (void)size; \
         return NVWA::fixed_mem_pool<_Cls>::allocate(); \
     } \
     static void  operator delete(void* ptr) \
@@ -316,6 +409,7 @@ public: \
     static void* operator new(size_t size) \
     { \
         assert(size == sizeof(_Cls)); \
+        (void)size; \
         return NVWA::fixed_mem_pool<_Cls>::allocate(); \
     } \
     static void  operator delete(void* ptr) \
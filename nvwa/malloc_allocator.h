@@ -33,7 +33,7 @@
  * It is necessary in the implementation of operator new/delete in order
  * to avoid dead loops.
  *
- * @date  2024-05-20
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_MALLOC_ALLOCATOR_H
@@ -71,6 +71,18 @@ struct malloc_allocator {
     }
 };
 
+template <typename T, typename U>
+bool operator==(const malloc_allocator<T>&, const malloc_allocator<U>&)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const malloc_allocator<T>&, const malloc_allocator<U>&)
+{
+    return false;
+}
+
 NVWA_NAMESPACE_END
 
 #endif // NVWA_MALLOC_ALLOCATOR_H
@@ -0,0 +1,166 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+/**
+ * @file  mem_arena.cpp
+ *
+ * Non-inline code for the monotonic memory arena.
+ *
+ * @date  2026-10-16
+ */
+
+#include "mem_arena.h"          // nvwa::mem_arena
+#include <new>                  // std::bad_alloc
+#include <assert.h>             // assert
+#include <stddef.h>             // size_t
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+#include "mem_pool_base.h"      // nvwa::mem_pool_base
+
+NVWA_NAMESPACE_BEGIN
+
+/**
+ * Constructs an arena whose memory comes from the system.  The first
+ * block is allocated immediately.
+ *
+ * @param block_size  usable size of each block
+ * @param growable    whether more blocks can be chained when the first
+ *                    one is exhausted
+ * @throw bad_alloc   memory is insufficient
+ */
+mem_arena::mem_arena(size_t block_size, bool growable)
+    : _M_block_size(block_size), _M_growable(growable), _M_owns_head(true)
+{
+    void* ptr = mem_pool_base::alloc_sys(_S_header_size + block_size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    _M_head = static_cast<_Block*>(ptr);
+    _M_head->_M_next = nullptr;
+    _M_head->_M_end = _S_begin(_M_head) + block_size;
+    reset();
+}
+
+/**
+ * Constructs an arena whose first block is a user-provided buffer.
+ * The buffer is not freed by the arena.
+ *
+ * @param buffer      pointer to the buffer, suitably aligned for a
+ *                    pointer
+ * @param size        size of the buffer, which must be bigger than the
+ *                    block header
+ * @param growable    whether more blocks (of the same size as the
+ *                    buffer) can be chained when the buffer is
+ *                    exhausted
+ */
+mem_arena::mem_arena(void* buffer, size_t size, bool growable)
+    : _M_head(static_cast<_Block*>(buffer)),
+      _M_block_size(size - _S_header_size),
+      _M_growable(growable),
+      _M_owns_head(false)
+{
+    assert(size > _S_header_size);
+    _M_head->_M_next = nullptr;
+    _M_head->_M_end = static_cast<char*>(buffer) + size;
+    reset();
+}
+
+/**
+ * Destructor that frees all the blocks allocated from the system.
+ */
+mem_arena::~mem_arena()
+{
+    release();
+    if (_M_owns_head) {
+        mem_pool_base::dealloc_sys(_M_head);
+    }
+}
+
+/**
+ * Frees all the blocks except the first one, and rewinds the arena to
+ * the beginning.
+ */
+void mem_arena::release()
+{
+    _Block* block = _M_head->_M_next;
+    while (block) {
+        _Block* next = block->_M_next;
+        mem_pool_base::dealloc_sys(block);
+        block = next;
+    }
+    _M_head->_M_next = nullptr;
+    reset();
+}
+
+/**
+ * Allocates memory when the current block is exhausted.  The next kept
+ * block is tried first, and a new block is chained after the current
+ * one if the next block does not exist or is too small.
+ *
+ * @param size       size of memory to allocate
+ * @param alignment  alignment required
+ * @return           pointer to allocated memory if successful; null
+ *                   otherwise
+ */
+void* mem_arena::_M_allocate_slow(size_t size, size_t alignment)
+{
+    if (_Block* next = _M_current->_M_next) {
+        char* ptr = _S_align(_S_begin(next), alignment);
+        if (ptr <= next->_M_end && size <= size_t(next->_M_end - ptr)) {
+            _M_current = next;
+            _M_ptr = ptr + size;
+            _M_end = next->_M_end;
+            return ptr;
+        }
+    }
+    if (!_M_growable) {
+        return nullptr;
+    }
+
+    size_t needed = size;
+    if (alignment > alignof(max_align_t)) {
+        needed += alignment - alignof(max_align_t);
+    }
+    if (needed < size || needed > size_t(-1) - _S_header_size) {
+        return nullptr;
+    }
+    size_t block_size = _M_block_size < needed ? needed : _M_block_size;
+    auto block = static_cast<_Block*>(
+        mem_pool_base::alloc_sys(_S_header_size + block_size));
+    if (block == nullptr) {
+        return nullptr;
+    }
+    block->_M_next = _M_current->_M_next;
+    block->_M_end = _S_begin(block) + block_size;
+    _M_current->_M_next = block;
+    _M_current = block;
+    _M_ptr = _S_begin(block);
+    _M_end = block->_M_end;
+    return allocate(size, alignment);
+}
+
+NVWA_NAMESPACE_END
@@ -0,0 +1,288 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+/**
+ * @file  mem_arena.h
+ *
+ * Header file for a monotonic memory arena, which allocates memory by
+ * bumping a pointer and frees it all at once.  It can be used directly,
+ * as a \c std::pmr::memory_resource, or as an STL allocator.  The
+ * current code requires a C++11-compliant compiler; mem_arena_resource
+ * is available only when the C++17 header <memory_resource> is.
+ *
+ * @date  2026-10-16
+ */
+
+#ifndef NVWA_MEM_ARENA_H
+#define NVWA_MEM_ARENA_H
+
+#include <new>                  // std::bad_alloc/std::bad_array_new_length
+#include <type_traits>          // std::false_type/std::true_type
+#include <stddef.h>             // size_t/max_align_t
+#include <stdint.h>             // uintptr_t
+#include "_nvwa.h"              // NVWA macros
+#include "c++_features.h"       // HAVE_CXX17_MEMORY_RESOURCE
+
+#if HAVE_CXX17_MEMORY_RESOURCE
+#include <memory_resource>      // std::pmr::memory_resource
+#endif
+
+NVWA_NAMESPACE_BEGIN
+
+/**
+ * Monotonic memory arena.  Memory is allocated by bumping a pointer in
+ * the current block, and is only reclaimed by mem_arena::rewind or
+ * mem_arena::reset.  When a block is exhausted, a new block is chained
+ * (unless the arena is not growable).  Blocks are kept on rewinding, so
+ * that they can be reused without asking the system again.
+ *
+ * An arena is not thread-safe.  It is meant to be used by one thread at
+ * a time, say, as a \c thread_local object or an object owned by a
+ * request handler.
+ */
+class mem_arena {
+    struct _Block {
+        _Block* _M_next;        ///< Pointer to the next block
+        char*   _M_end;         ///< End of the usable memory
+    };
+
+public:
+    /** Position in the arena, to which the arena can be rewound. */
+    class mark_type {
+        friend class mem_arena;
+        _Block* _M_block;
+        char*   _M_ptr;
+    };
+
+    class scope;
+
+    explicit mem_arena(size_t block_size = 4096, bool growable = true);
+    mem_arena(void* buffer, size_t size, bool growable = false);
+    ~mem_arena();
+
+    /**
+     * Allocates memory from the arena.
+     *
+     * @param size       size of memory to allocate
+     * @param alignment  alignment required (must be a power of two)
+     * @return           pointer to allocated memory if successful;
+     *                   null otherwise
+     */
+    void* allocate(size_t size, size_t alignment = alignof(max_align_t))
+    {
+        char* ptr = _S_align(_M_ptr, alignment);
+        if (ptr <= _M_end && size <= size_t(_M_end - ptr)) {
+            _M_ptr = ptr + size;
+            return ptr;
+        }
+        return _M_allocate_slow(size, alignment);
+    }
+    /**
+     * Gets the current position of the arena.
+     *
+     * @return  the position to pass to mem_arena::rewind later
+     */
+    mark_type mark() const
+    {
+        mark_type result;
+        result._M_block = _M_current;
+        result._M_ptr = _M_ptr;
+        return result;
+    }
+    /**
+     * Rewinds the arena to a previous position, so that all memory
+     * allocated since then can be reused.  Marks obtained after \a pos
+     * become invalid.
+     *
+     * @param pos  position returned by mem_arena::mark
+     */
+    void rewind(const mark_type& pos)
+    {
+        _M_current = pos._M_block;
+        _M_ptr = pos._M_ptr;
+        _M_end = pos._M_block->_M_end;
+    }
+    /**
+     * Rewinds the arena to the beginning, so that all memory can be
+     * reused.  The blocks are kept.
+     */
+    void reset()
+    {
+        _M_current = _M_head;
+        _M_ptr = _S_begin(_M_head);
+        _M_end = _M_head->_M_end;
+    }
+    void release();
+
+    mem_arena(const mem_arena&) = delete;
+    mem_arena& operator=(const mem_arena&) = delete;
+
+private:
+    static char* _S_align(char* ptr, size_t alignment)
+    {
+        return reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(ptr) + alignment - 1) &
+            ~(alignment - 1));
+    }
+    static char* _S_begin(_Block* block)
+    {
+        return reinterpret_cast<char*>(block) + _S_header_size;
+    }
+    void* _M_allocate_slow(size_t size, size_t alignment);
+
+    /** Size of a block header, keeping the memory aligned. */
+    static constexpr size_t _S_header_size =
+        (sizeof(_Block) + alignof(max_align_t) - 1) &
+        ~(alignof(max_align_t) - 1);
+
+    _Block* _M_head;            ///< First block (may be a user buffer)
+    _Block* _M_current;         ///< Block being allocated from
+    char*   _M_ptr;             ///< Next free byte in the current block
+    char*   _M_end;             ///< End of the current block
+    size_t  _M_block_size;      ///< Usable size of a new block
+    bool    _M_growable;        ///< Whether new blocks can be chained
+    bool    _M_owns_head;       ///< Whether the first block is ours
+};
+
+/**
+ * RAII class to rewind an arena on exit of a scope.  Scopes can be
+ * nested.
+ */
+class mem_arena::scope {
+public:
+    explicit scope(mem_arena& arena) : _M_arena(arena), _M_mark(arena.mark())
+    {
+    }
+    ~scope()
+    {
+        _M_arena.rewind(_M_mark);
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+private:
+    mem_arena& _M_arena;
+    const mark_type _M_mark;
+};
+
+#if HAVE_CXX17_MEMORY_RESOURCE
+/**
+ * Memory resource that allocates from a mem_arena.  Deallocation does
+ * nothing: memory is reclaimed when the arena is rewound or reset.
+ */
+class mem_arena_resource : public std::pmr::memory_resource {
+public:
+    explicit mem_arena_resource(mem_arena& arena) noexcept
+        : _M_arena(arena)
+    {
+    }
+    mem_arena& arena() const noexcept
+    {
+        return _M_arena;
+    }
+
+private:
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        if (void* ptr = _M_arena.allocate(size, alignment)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override
+    {
+        auto ptr = dynamic_cast<const mem_arena_resource*>(&other);
+        return ptr != nullptr && &ptr->_M_arena == &_M_arena;
+    }
+
+    mem_arena& _M_arena;
+};
+#endif
+
+/**
+ * An allocator that allocates from a mem_arena.  Deallocation does
+ * nothing: memory is reclaimed when the arena is rewound or reset.
+ */
+template <typename T>
+struct mem_arena_allocator {
+    typedef T value_type;
+    typedef std::false_type is_always_equal;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    explicit mem_arena_allocator(mem_arena& arena) noexcept
+        : _M_arena(&arena)
+    {
+    }
+    template <typename U>
+    mem_arena_allocator(const mem_arena_allocator<U>& other) noexcept
+        : _M_arena(other._M_arena)
+    {
+    }
+
+    template <typename U>
+    struct rebind {
+        typedef mem_arena_allocator<U> other;
+    };
+
+    T* allocate(size_t n)
+    {
+        if (n > size_t(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        if (void* ptr = _M_arena->allocate(n * sizeof(T), alignof(T))) {
+            return static_cast<T*>(ptr);
+        }
+        throw std::bad_alloc();
+    }
+    void deallocate(T*, size_t) {}
+
+    mem_arena* _M_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const mem_arena_allocator<T>& lhs,
+                const mem_arena_allocator<U>& rhs) noexcept
+{
+    return lhs._M_arena == rhs._M_arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const mem_arena_allocator<T>& lhs,
+                const mem_arena_allocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+NVWA_NAMESPACE_END
+
+#endif // NVWA_MEM_ARENA_H
@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2017 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,10 +31,11 @@
  *
  * Implementation for the memory pool base.
  *
- * @date  2017-09-09
+ * @date  2026-10-16
  */
 
 #include "mem_pool_base.h"      // nvwa::mem_pool_base
+#include <functional>           // std::less
 
 #if defined(_MEM_POOL_USE_MALLOC)
 #include <stdlib.h>             // malloc/free
@@ -42,7 +43,14 @@
 #include <new>                  // std::bad_alloc
 #endif
 
-#include "_nvwa.h"              // NVWA_NAMESPACE_*
+#include "_nvwa.h"              // NVWA_NAMESPACE_*/NVWA_LINUX
+
+#if NVWA_LINUX
+#include <stdint.h>             // uintptr_t
+#include <sys/mman.h>           // mmap/munmap/madvise
+#include <sys/syscall.h>        // SYS_getcpu/SYS_mbind
+#include <unistd.h>             // syscall
+#endif
 
 NVWA_NAMESPACE_BEGIN
 
@@ -62,6 +70,31 @@ NVWA_NAMESPACE_BEGIN
  * needs to be implemented in subclasses.
  */
 
+/**
+ * Gets the counters of the memory pool.  The base implementation
+ * provides no counters.
+ *
+ * @param[out] stats  snapshot of the counters, if successful
+ * @return            \c true if the counters are available; \c false
+ *                    otherwise
+ */
+bool mem_pool_base::get_stats(mem_pool_stats& /*stats*/)
+{
+    return false;
+}
+
+/**
+ * Checks whether the memory pool can be used (and recycled) from any
+ * thread.  The base implementation assumes not.
+ *
+ * @return  \c true if the memory pool is protected by a lock; \c false
+ *          otherwise
+ */
+bool mem_pool_base::is_thread_safe() const
+{
+    return false;
+}
+
 /**
  * Empty base destructor.
  */
@@ -91,4 +124,177 @@ void mem_pool_base::dealloc_sys(void* ptr)
     _MEM_POOL_DEALLOCATE(ptr);
 }
 
+#if NVWA_LINUX
+namespace {
+
+/** Memory policy that prefers the given nodes (from numaif.h). */
+const int mpol_preferred = 1;
+
+size_t round_up(size_t size, size_t granularity)
+{
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+char* map_anonymous(size_t size, int flags)
+{
+    void* ptr = mmap(_NULLPTR, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return ptr == MAP_FAILED ? _NULLPTR : static_cast<char*>(ptr);
+}
+
+} /* unnamed namespace */
+#endif
+
+/**
+ * Maps memory in huge pages.
+ *
+ * @param size  size of the memory to allocate in bytes
+ * @return      pointer to allocated memory block if successful; or
+ *              null if memory allocation fails
+ */
+void* huge_page_backing::allocate(size_t size)
+{
+#if NVWA_LINUX
+    size = round_up(size, granularity);
+#ifdef MAP_HUGETLB
+    if (char* ptr = map_anonymous(size, MAP_HUGETLB)) {
+        return ptr;
+    }
+#endif
+    // No reserved huge pages are available: map an aligned region that
+    // transparent huge pages can back
+    char* ptr = map_anonymous(size + granularity, 0);
+    if (ptr == _NULLPTR) {
+        return _NULLPTR;
+    }
+    char* aligned_ptr = reinterpret_cast<char*>(
+        round_up(reinterpret_cast<uintptr_t>(ptr), granularity));
+    size_t head = aligned_ptr - ptr;
+    if (head != 0) {
+        munmap(ptr, head);
+    }
+    if (head != granularity) {
+        munmap(aligned_ptr + size, granularity - head);
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(aligned_ptr, size, MADV_HUGEPAGE);
+#endif
+    return aligned_ptr;
+#else
+    return mem_pool_base::alloc_sys(size);
+#endif
+}
+
+/**
+ * Unmaps memory allocated by huge_page_backing::allocate.
+ *
+ * @param ptr   pointer to the memory block previously allocated
+ * @param size  size of the memory block passed to \e allocate
+ */
+void huge_page_backing::deallocate(void* ptr, size_t size)
+{
+#if NVWA_LINUX
+    munmap(ptr, round_up(size, granularity));
+#else
+    (void)size;
+    mem_pool_base::dealloc_sys(ptr);
+#endif
+}
+
+/**
+ * Maps memory on the NUMA node of the calling thread.
+ *
+ * @param size  size of the memory to allocate in bytes
+ * @return      pointer to allocated memory block if successful; or
+ *              null if memory allocation fails
+ */
+void* numa_local_backing::allocate(size_t size)
+{
+#if NVWA_LINUX
+    char* ptr = map_anonymous(size, 0);
+    if (ptr == _NULLPTR) {
+        return _NULLPTR;
+    }
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+    unsigned cpu;
+    unsigned node;
+    if (syscall(SYS_getcpu, &cpu, &node, _NULLPTR) == 0 &&
+            node < sizeof(unsigned long) * 8) {
+        unsigned long node_mask = 1UL << node;
+        // Failure is harmless: the default policy is first touch
+        syscall(SYS_mbind, ptr, size, mpol_preferred, &node_mask,
+                sizeof node_mask * 8 + 1, 0);
+    }
+#endif
+    return ptr;
+#else
+    return mem_pool_base::alloc_sys(size);
+#endif
+}
+
+/**
+ * Unmaps memory allocated by numa_local_backing::allocate.
+ *
+ * @param ptr   pointer to the memory block previously allocated
+ * @param size  size of the memory block passed to \e allocate
+ */
+void numa_local_backing::deallocate(void* ptr, size_t size)
+{
+#if NVWA_LINUX
+    munmap(ptr, size);
+#else
+    (void)size;
+    mem_pool_base::dealloc_sys(ptr);
+#endif
+}
+
+/**
+ * Sorts a list of memory blocks by their addresses.  It is a bottom-up
+ * merge sort, which needs no extra memory, so that it can be safely
+ * used when the system is already short of memory.
+ *
+ * @param head  pointer to the first memory block in the list
+ * @return      pointer to the first memory block in the sorted list
+ */
+mem_pool_base::_Block_list*
+mem_pool_base::sort_block_list(_Block_list* head)
+{
+    std::less<_Block_list*> less;
+    for (size_t width = 1; ; width *= 2) {
+        _Block_list* left = head;
+        _Block_list** tail = &head;
+        size_t merge_cnt = 0;
+        while (left) {
+            ++merge_cnt;
+            _Block_list* right = left;
+            size_t left_len = 0;
+            while (right && left_len < width) {
+                right = right->_M_next;
+                ++left_len;
+            }
+            size_t right_len = width;
+            while (left_len > 0 || (right_len > 0 && right)) {
+                _Block_list* block;
+                if (left_len != 0 &&
+                        (right_len == 0 || !right || !less(right, left))) {
+                    block = left;
+                    left = left->_M_next;
+                    --left_len;
+                } else {
+                    block = right;
+                    right = right->_M_next;
+                    --right_len;
+                }
+                *tail = block;
+                tail = &block->_M_next;
+            }
+            left = right;
+        }
+        *tail = _NULLPTR;
+        if (merge_cnt <= 1) {
+            return head;
+        }
+    }
+}
+
 NVWA_NAMESPACE_END
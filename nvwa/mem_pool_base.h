@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2024 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,7 +31,7 @@
  *
  * Header file for the memory pool base.
  *
- * @date  2024-05-20
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_MEM_POOL_BASE_H
@@ -43,26 +43,104 @@
 
 NVWA_NAMESPACE_BEGIN
 
+/**
+ * Snapshot of the counters of a memory pool.  Counts of blocks are
+ * those at the time of the snapshot, and the other counters are
+ * cumulative since the creation of the memory pool.
+ */
+struct mem_pool_stats {
+    size_t block_size;          ///< Size of a memory block
+    int    group_id;            ///< Group ID of the memory pool
+    size_t blocks_in_use;       ///< Blocks given out to users
+    size_t blocks_free;         ///< Blocks in the free list
+    size_t sys_allocs;          ///< Allocations from the system
+    size_t sys_deallocs;        ///< Deallocations to the system
+    size_t lock_acquisitions;   ///< Times the pool lock is acquired
+    size_t lock_contentions;    ///< Times waiting for the pool lock
+};
+
 /**
  * Base class for memory pools.
  */
 class mem_pool_base {
 public:
+    /** Structure to store the next available memory block. */
+    struct _Block_list {
+        _Block_list* _M_next;   ///< Pointer to the next memory block
+    };
+
     virtual ~mem_pool_base();
     virtual void recycle() = 0;
+    virtual bool get_stats(mem_pool_stats& stats);
+    virtual bool is_thread_safe() const;
     static void* alloc_sys(size_t size);
     static void dealloc_sys(void* ptr);
+    static _Block_list* sort_block_list(_Block_list* head);
 
-    /** Structure to store the next available memory block. */
-    struct _Block_list {
-        _Block_list* _M_next;   ///< Pointer to the next memory block
-    };
+protected:
+    mem_pool_base() {}
 
 private:
     mem_pool_base(const mem_pool_base&) _DELETED;
     mem_pool_base& operator=(const mem_pool_base&) _DELETED;
 };
 
+/**
+ * @def _MEM_POOL_HUGE_PAGE_SIZE
+ *
+ * Size of a huge page in bytes.  It is the allocation granularity of
+ * nvwa#huge_page_backing.
+ */
+#ifndef _MEM_POOL_HUGE_PAGE_SIZE
+#define _MEM_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+/**
+ * Backing policy for memory pools that uses mem_pool_base::alloc_sys
+ * and mem_pool_base::dealloc_sys.  It is the default.
+ *
+ * A backing policy provides \c granularity, the preferred allocation
+ * unit (a power of two), and the functions \c allocate and \c
+ * deallocate.  The same size must be passed to \c deallocate as to \c
+ * allocate.
+ */
+struct sys_backing {
+    static const size_t granularity = 1;
+    static void* allocate(size_t size)
+    {
+        return mem_pool_base::alloc_sys(size);
+    }
+    static void deallocate(void* ptr, size_t /*size*/)
+    {
+        mem_pool_base::dealloc_sys(ptr);
+    }
+};
+
+/**
+ * Backing policy for memory pools that maps huge pages.  Reserved huge
+ * pages (\c MAP_HUGETLB) are tried first, and transparent huge pages
+ * are requested on an aligned mapping otherwise.  The allocation size
+ * is rounded up to #_MEM_POOL_HUGE_PAGE_SIZE.  It is the same as
+ * nvwa#sys_backing on platforms other than Linux.
+ */
+struct huge_page_backing {
+    static const size_t granularity = _MEM_POOL_HUGE_PAGE_SIZE;
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size);
+};
+
+/**
+ * Backing policy for memory pools that maps memory preferably on the
+ * NUMA node of the calling thread.  If the kernel does not support the
+ * memory policy, memory is placed where it is first touched.  It is the
+ * same as nvwa#sys_backing on platforms other than Linux.
+ */
+struct numa_local_backing {
+    static const size_t granularity = 4096;
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size);
+};
+
 NVWA_NAMESPACE_END
 
 #endif // NVWA_MEM_POOL_BASE_H
@@ -0,0 +1,279 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+/**
+ * @file  mem_pool_resource.h
+ *
+ * Adapters to use static_mem_pool and fixed_mem_pool as C++17
+ * \c std::pmr::memory_resource, so that \c std::pmr containers can
+ * allocate from the memory pools.
+ *
+ * @date  2026-10-16
+ */
+
+#ifndef NVWA_MEM_POOL_RESOURCE_H
+#define NVWA_MEM_POOL_RESOURCE_H
+
+#include "c++_features.h"       // HAVE_CXX17_MEMORY_RESOURCE
+
+#if !HAVE_CXX17_MEMORY_RESOURCE
+#error "mem_pool_resource.h requires std::pmr::memory_resource."
+#endif
+
+#include <memory_resource>      // std::pmr::memory_resource
+#include <new>                  // std::bad_alloc
+#include <stddef.h>             // size_t
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+#include "fixed_mem_pool.h"     // nvwa::fixed_mem_pool
+#include "static_mem_pool.h"    // nvwa::static_mem_pool
+
+NVWA_NAMESPACE_BEGIN
+
+/**
+ * Memory resource that routes each request to the static_mem_pool of
+ * the smallest size class that fits.  Requests that are bigger than the
+ * biggest size class, or need an alignment that the memory pool cannot
+ * guarantee, go to the upstream resource.
+ *
+ * All resources of the same type share the same memory pools.
+ *
+ * @param _Gid    group ID of the memory pools (negative for thread
+ *                safety)
+ * @param _Sizes  size classes in ascending order, each a multiple of
+ *                \c sizeof(void*)
+ */
+template <int _Gid, size_t... _Sizes>
+class basic_static_mem_pool_resource : public std::pmr::memory_resource {
+public:
+    /**
+     * Constructor.  It makes sure that all the memory pools exist.
+     *
+     * @param upstream  resource to serve the requests that the memory
+     *                  pools cannot
+     */
+    explicit basic_static_mem_pool_resource(
+        std::pmr::memory_resource* upstream =
+            std::pmr::get_default_resource())
+        : _M_upstream(upstream)
+    {
+        (static_mem_pool<_Sizes, _Gid>::instance(), ...);
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept
+    {
+        return _M_upstream;
+    }
+
+private:
+    static constexpr size_t _S_granule = sizeof(void*);
+    static constexpr size_t _S_class_cnt = sizeof...(_Sizes);
+    static constexpr size_t _S_sizes[] = {_Sizes...};
+    static constexpr size_t _S_max_size = _S_sizes[_S_class_cnt - 1];
+
+    struct _Class_table {
+        unsigned char _M_index[_S_max_size / _S_granule + 1];
+        size_t        _M_alignment[_S_class_cnt];
+    };
+
+    static constexpr _Class_table _S_make_class_table()
+    {
+        _Class_table table{};
+        size_t cls = 0;
+        for (size_t i = 0; i <= _S_max_size / _S_granule; ++i) {
+            while (_S_sizes[cls] < i * _S_granule) {
+                ++cls;
+            }
+            table._M_index[i] = static_cast<unsigned char>(cls);
+        }
+        for (cls = 0; cls < _S_class_cnt; ++cls) {
+            size_t alignment = _S_sizes[cls] & (~_S_sizes[cls] + 1);
+            table._M_alignment[cls] =
+                alignment < _STATIC_MEM_POOL_SLAB_ALIGNMENT
+                    ? alignment
+                    : _STATIC_MEM_POOL_SLAB_ALIGNMENT;
+        }
+        return table;
+    }
+
+    static constexpr bool _S_check_sizes()
+    {
+        for (size_t i = 0; i < _S_class_cnt; ++i) {
+            if (_S_sizes[i] == 0 || _S_sizes[i] % _S_granule != 0 ||
+                    (i > 0 && _S_sizes[i] <= _S_sizes[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(_S_class_cnt > 0 && _S_class_cnt < 256,
+                  "Bad number of size classes");
+    static_assert(_S_check_sizes(), "Bad size classes");
+
+    static constexpr _Class_table _S_class_table = _S_make_class_table();
+
+    typedef void* (*_Alloc_func)();
+    typedef void (*_Dealloc_func)(void*);
+
+    template <size_t _Sz>
+    static void* _S_allocate()
+    {
+        return static_mem_pool<_Sz, _Gid>::instance_known().allocate();
+    }
+    template <size_t _Sz>
+    static void _S_deallocate(void* ptr)
+    {
+        static_mem_pool<_Sz, _Gid>::instance_known().deallocate(ptr);
+    }
+
+    static constexpr _Alloc_func _S_alloc_funcs[] = {
+        &_S_allocate<_Sizes>...};
+    static constexpr _Dealloc_func _S_dealloc_funcs[] = {
+        &_S_deallocate<_Sizes>...};
+
+    /**
+     * Finds the size class for a request.
+     *
+     * @return  index of the size class; or \c _S_class_cnt if the
+     *          request should go upstream
+     */
+    static size_t _S_find_class(size_t size, size_t alignment)
+    {
+        if (size > _S_max_size) {
+            return _S_class_cnt;
+        }
+        size_t cls =
+            _S_class_table._M_index[(size + _S_granule - 1) / _S_granule];
+        if (alignment > _S_class_table._M_alignment[cls]) {
+            return _S_class_cnt;
+        }
+        return cls;
+    }
+
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        size_t cls = _S_find_class(size, alignment);
+        if (cls == _S_class_cnt) {
+            return _M_upstream->allocate(size, alignment);
+        }
+        if (void* ptr = _S_alloc_funcs[cls]()) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+    void do_deallocate(void* ptr, size_t size, size_t alignment) override
+    {
+        size_t cls = _S_find_class(size, alignment);
+        if (cls == _S_class_cnt) {
+            _M_upstream->deallocate(ptr, size, alignment);
+        } else {
+            _S_dealloc_funcs[cls](ptr);
+        }
+    }
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override
+    {
+        auto ptr =
+            dynamic_cast<const basic_static_mem_pool_resource*>(&other);
+        return ptr != nullptr && *ptr->_M_upstream == *_M_upstream;
+    }
+
+    std::pmr::memory_resource* _M_upstream;
+};
+
+/**
+ * Memory resource that uses thread-safe static memory pools with the
+ * default size classes.
+ */
+typedef basic_static_mem_pool_resource<-1,
+                                       16, 32, 48, 64, 80, 96, 128,
+                                       160, 192, 256, 320, 384, 512>
+    static_mem_pool_resource;
+
+/**
+ * Memory resource that allocates from fixed_mem_pool<_Tp>.  Requests
+ * that are bigger than the block size, or need a bigger alignment,
+ * go to the upstream resource.  The fixed_mem_pool needs to be
+ * initialized before use, as usual.
+ *
+ * @param _Tp  class whose fixed_mem_pool is used
+ */
+template <class _Tp>
+class fixed_mem_pool_resource : public std::pmr::memory_resource {
+public:
+    explicit fixed_mem_pool_resource(
+        std::pmr::memory_resource* upstream =
+            std::pmr::get_default_resource()) noexcept
+        : _M_upstream(upstream)
+    {
+    }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept
+    {
+        return _M_upstream;
+    }
+
+private:
+    typedef fixed_mem_pool<_Tp> pool_type;
+
+    static bool _S_fits(size_t size, size_t alignment)
+    {
+        return size <= pool_type::block_size::value &&
+               alignment <= pool_type::alignment::value;
+    }
+
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        if (!_S_fits(size, alignment)) {
+            return _M_upstream->allocate(size, alignment);
+        }
+        if (void* ptr = pool_type::allocate()) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+    void do_deallocate(void* ptr, size_t size, size_t alignment) override
+    {
+        if (!_S_fits(size, alignment)) {
+            _M_upstream->deallocate(ptr, size, alignment);
+        } else {
+            pool_type::deallocate(ptr);
+        }
+    }
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override
+    {
+        auto ptr = dynamic_cast<const fixed_mem_pool_resource*>(&other);
+        return ptr != nullptr && *ptr->_M_upstream == *_M_upstream;
+    }
+
+    std::pmr::memory_resource* _M_upstream;
+};
+
+NVWA_NAMESPACE_END
+
+#endif // NVWA_MEM_POOL_RESOURCE_H
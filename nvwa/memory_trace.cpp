@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2022-2024 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2022-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,7 +31,7 @@
  *
  * Implementation of memory tracing facilities.
  *
- * @date  2024-05-20
+ * @date  2026-10-16
  */
 
 #include "memory_trace.h"       // memory trace declarations
@@ -41,6 +41,8 @@
 #include <stdint.h>             // uint32_t/uintptr_t
 #include <stdlib.h>             // abort/malloc/free
 #include <string.h>             // strcmp
+#include <algorithm>            // std::lower_bound/std::sort
+#include <chrono>               // std::chrono::steady_clock
 #include <deque>                // std::deque
 #include <new>                  // operator new declarations
 #include "_nvwa.h"              // NVWA macros
@@ -52,6 +54,21 @@
 #define NVWA_CMT_ERROR_ACTION() abort()
 #endif
 
+// Non-zero to record size and lifetime histograms for each context
+#ifndef NVWA_CMT_PROFILING
+#define NVWA_CMT_PROFILING 0
+#endif
+
+// Non-zero to record allocation events to the binary event trace, with
+// the context ID as the event ID; alloc_trace.cpp should be linked in
+#ifndef NVWA_CMT_TRACE_EVENTS
+#define NVWA_CMT_TRACE_EVENTS 0
+#endif
+
+#if NVWA_CMT_TRACE_EVENTS
+#include "alloc_trace.h"        // nvwa::trace_alloc_event
+#endif
+
 #define NVWA_CMT_ERROR_MESSAGE(...)                               \
     do {                                                          \
         NVWA::fast_mutex_autolock output_guard{new_output_lock};  \
@@ -62,35 +79,92 @@ namespace {
 
 NVWA::fast_mutex new_ptr_lock;
 NVWA::fast_mutex new_output_lock;
+NVWA::fast_mutex context_lock;
 
 enum is_array_t : uint32_t {
     alloc_is_not_array,
     alloc_is_array
 };
 
-thread_local std::deque<NVWA::context,
-                        NVWA::malloc_allocator<NVWA::context>>
-    context_stack{{"<UNKNOWN>", "<UNKNOWN>"}};
+// Contexts are interned in a registry, and are identified by their
+// indices in it.  ID 0 is reserved for the unknown context.  The
+// registry and the hash table of IDs are protected by context_lock.
+constexpr uint32_t MAX_CONTEXT_ID = (1U << 26) - 1;
+const NVWA::context unknown_context{"<UNKNOWN>", "<UNKNOWN>"};
+NVWA::context* context_registry = nullptr;
+size_t context_registry_size = 1;
+size_t context_registry_capacity = 0;
+uint32_t* context_buckets = nullptr;
+size_t context_bucket_cnt = 0;
+
+thread_local std::deque<uint32_t, NVWA::malloc_allocator<uint32_t>>
+    context_stack{0};
+
+size_t hash_context(const NVWA::context& ctx)
+{
+    size_t hash = 2166136261U;
+    for (const char* p = ctx.file; *p != '\0'; ++p) {
+        hash = (hash ^ static_cast<unsigned char>(*p)) * 16777619U;
+    }
+    for (const char* p = ctx.func; *p != '\0'; ++p) {
+        hash = (hash ^ static_cast<unsigned char>(*p)) * 16777619U;
+    }
+    return hash;
+}
+
+void insert_context_id(uint32_t* buckets, size_t bucket_cnt, uint32_t id)
+{
+    size_t mask = bucket_cnt - 1;
+    size_t i = hash_context(context_registry[id]) & mask;
+    while (buckets[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    buckets[i] = id;
+}
+
+// The caller should hold context_lock
+const NVWA::context& lookup_context(uint32_t ctx_id)
+{
+    if (ctx_id == 0 || ctx_id >= context_registry_size) {
+        return unknown_context;
+    }
+    return context_registry[ctx_id];
+}
+
+template <typename _Container>
+void fill_contexts(_Container& items)
+{
+    NVWA::fast_mutex_autolock guard{context_lock};
+    for (auto& item : items) {
+        item.ctx = lookup_context(item.ctx_id);
+    }
+}
 
-const NVWA::context& get_current_context()
+uint32_t get_current_context()
 {
     assert(!context_stack.empty());
     return context_stack.back();
 }
 
+void print_context(uint32_t ctx_id, FILE* fp)
+{
+    NVWA::context ctx = NVWA::get_context(ctx_id);
+    fprintf(fp, "context: %s/%s", ctx.file, ctx.func);
+}
+
 void print_context(const NVWA::context& ctx, FILE* fp)
 {
     fprintf(fp, "context: %s/%s", ctx.file, ctx.func);
 }
 
-void save_context(const NVWA::context& ctx)
+void save_context(uint32_t ctx_id)
 {
-    context_stack.push_back(ctx);
+    context_stack.push_back(ctx_id);
 }
 
-void restore_context([[maybe_unused]] const NVWA::context& ctx)
+void restore_context([[maybe_unused]] uint32_t ctx_id)
 {
-    assert(!context_stack.empty() && context_stack.back() == ctx);
+    assert(!context_stack.empty() && context_stack.back() == ctx_id);
     context_stack.pop_back();
 }
 
@@ -101,7 +175,9 @@ NVWA_NAMESPACE_BEGIN
 bool new_autocheck_flag = true;
 bool new_verbose_flag = false;
 FILE* new_output_fp = stderr;
+bool new_profile_report_flag = true;
 size_t current_mem_alloc = 0;
+size_t current_alloc_cnt = 0;
 size_t total_mem_alloc_cnt_accum = 0;
 
 bool operator==(const context& lhs, const context& rhs)
@@ -115,14 +191,77 @@ bool operator!=(const context& lhs, const context& rhs)
     return !(lhs == rhs);
 }
 
-checkpoint::checkpoint(const context& ctx) : ctx_(ctx)
+uint32_t intern_context(const context& ctx)
+{
+    size_t hash = hash_context(ctx);
+    fast_mutex_autolock guard{context_lock};
+    if (context_bucket_cnt != 0) {
+        size_t mask = context_bucket_cnt - 1;
+        for (size_t i = hash & mask; context_buckets[i] != 0;
+                i = (i + 1) & mask) {
+            if (context_registry[context_buckets[i]] == ctx) {
+                return context_buckets[i];
+            }
+        }
+    }
+    if (context_registry_size > MAX_CONTEXT_ID) {
+        return 0;
+    }
+
+    if (context_registry_size >= context_registry_capacity) {
+        size_t capacity = context_registry_capacity == 0
+                              ? 64
+                              : context_registry_capacity * 2;
+        auto registry = static_cast<context*>(
+            realloc(context_registry, capacity * sizeof(context)));
+        if (registry == nullptr) {
+            return 0;
+        }
+        registry[0] = unknown_context;
+        context_registry = registry;
+        context_registry_capacity = capacity;
+    }
+    auto id = static_cast<uint32_t>(context_registry_size);
+    context_registry[id] = ctx;
+    if ((id + 1) * 2 > context_bucket_cnt) {
+        size_t bucket_cnt = context_bucket_cnt == 0
+                                ? 128
+                                : context_bucket_cnt * 2;
+        auto buckets = static_cast<uint32_t*>(
+            calloc(bucket_cnt, sizeof(uint32_t)));
+        if (buckets == nullptr) {
+            return 0;
+        }
+        for (uint32_t i = 1; i < id; ++i) {
+            insert_context_id(buckets, bucket_cnt, i);
+        }
+        free(context_buckets);
+        context_buckets = buckets;
+        context_bucket_cnt = bucket_cnt;
+    }
+    insert_context_id(context_buckets, context_bucket_cnt, id);
+    ++context_registry_size;
+    return id;
+}
+
+context get_context(uint32_t ctx_id)
+{
+    fast_mutex_autolock guard{context_lock};
+    return lookup_context(ctx_id);
+}
+
+checkpoint::checkpoint(uint32_t ctx_id) : ctx_id_(ctx_id)
+{
+    save_context(ctx_id);
+}
+
+checkpoint::checkpoint(const context& ctx) : checkpoint(intern_context(ctx))
 {
-    save_context(ctx);
 }
 
 checkpoint::~checkpoint()
 {
-    restore_context(ctx_);
+    restore_context(ctx_id_);
 }
 
 constexpr uint32_t CMT_MAGIC = 0x4D'58'54'43;  // "CTXM";
@@ -133,11 +272,14 @@ struct alloc_list_base {
 };
 
 struct alloc_list_t : alloc_list_base {
-    size_t   size;            ///< Size of the memory block
-    context  ctx;             ///< The context
-    uint32_t head_size : 31;  ///< Size of this struct, aligned
-    uint32_t is_array : 1;    ///< Non-zero iff <em>new[]</em> is used
-    uint32_t magic;           ///< Magic number for error detection
+    size_t   size;              ///< Size of the memory block
+    uint32_t ctx_id : 26;       ///< ID of the context
+    uint32_t align_shift : 5;   ///< Log2 of the alignment
+    uint32_t is_array : 1;      ///< Non-zero iff <em>new[]</em> is used
+#if NVWA_CMT_PROFILING
+    uint64_t alloc_time;        ///< Time of allocation in nanoseconds
+#endif
+    uint32_t magic;             ///< Magic number for error detection
 };
 
 alloc_list_base alloc_list = {
@@ -145,11 +287,108 @@ alloc_list_base alloc_list = {
     &alloc_list,  // tail (prev)
 };
 
+// Per-context statistics, indexed by the context ID.  They are
+// protected by new_ptr_lock, which is already held when the allocation
+// list is updated.
+struct context_counter_t {
+    size_t live_bytes;
+    size_t live_cnt;
+    size_t total_cnt;
+    size_t peak_bytes;
+#if NVWA_CMT_PROFILING
+    size_t size_hist[context_profile_bucket_cnt];
+    size_t lifetime_hist[context_profile_bucket_cnt];
+#endif
+};
+
+context_counter_t* context_counters = nullptr;
+size_t context_counter_cnt = 0;
+
+size_t get_bit_width(uint64_t value)
+{
+    size_t width = 0;
+    while (value != 0) {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+void add_context_alloc(uint32_t ctx_id, size_t size)
+{
+    if (ctx_id >= context_counter_cnt) {
+        size_t counter_cnt = (ctx_id + 1) * 2;
+        if (counter_cnt < 64) {
+            counter_cnt = 64;
+        }
+        auto counters = static_cast<context_counter_t*>(realloc(
+            context_counters, counter_cnt * sizeof(context_counter_t)));
+        if (counters == nullptr) {
+            return;
+        }
+        memset(counters + context_counter_cnt, 0,
+               (counter_cnt - context_counter_cnt) *
+                   sizeof(context_counter_t));
+        context_counters = counters;
+        context_counter_cnt = counter_cnt;
+    }
+    context_counter_t& counter = context_counters[ctx_id];
+    counter.live_bytes += size;
+    ++counter.live_cnt;
+    ++counter.total_cnt;
+    if (counter.live_bytes > counter.peak_bytes) {
+        counter.peak_bytes = counter.live_bytes;
+    }
+#if NVWA_CMT_PROFILING
+    ++counter.size_hist[get_bit_width(size)];
+#endif
+}
+
+void remove_context_alloc(uint32_t ctx_id, size_t size)
+{
+    if (ctx_id >= context_counter_cnt ||
+            context_counters[ctx_id].live_cnt == 0) {
+        return;
+    }
+    context_counters[ctx_id].live_bytes -= size;
+    --context_counters[ctx_id].live_cnt;
+}
+
+#if NVWA_CMT_PROFILING
+uint64_t get_timestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void add_context_lifetime(uint32_t ctx_id, uint64_t lifetime)
+{
+    if (ctx_id < context_counter_cnt) {
+        ++context_counters[ctx_id].lifetime_hist[get_bit_width(lifetime)];
+    }
+}
+#endif
+
 constexpr uint32_t align(size_t alignment, size_t s)
 {
     return static_cast<uint32_t>((s + alignment - 1) & ~(alignment - 1));
 }
 
+uint32_t get_head_size(const alloc_list_t* ptr)
+{
+    return align(size_t(1) << ptr->align_shift, sizeof(alloc_list_t));
+}
+
+uint32_t get_align_shift(size_t alignment)
+{
+    uint32_t shift = 0;
+    while ((size_t(1) << shift) < alignment) {
+        ++shift;
+    }
+    return shift;
+}
+
 alloc_list_t* convert_user_ptr(void* usr_ptr, size_t alignment)
 {
     auto offset = reinterpret_cast<uintptr_t>(usr_ptr);
@@ -186,7 +425,7 @@ alloc_list_t* convert_user_ptr(void* usr_ptr, size_t alignment)
     return nullptr;
 }
 
-void* alloc_mem(size_t size, const context& ctx, is_array_t is_array,
+void* alloc_mem(size_t size, uint32_t ctx_id, is_array_t is_array,
                 size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__)
 {
     assert(alignment >= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
@@ -205,10 +444,13 @@ void* alloc_mem(size_t size, const context& ctx, is_array_t is_array,
     }
 
     auto usr_ptr = reinterpret_cast<char*>(ptr) + aligned_list_node_size;
-    ptr->ctx = ctx;
+    ptr->ctx_id = ctx_id;
     ptr->is_array = is_array;
     ptr->size = size;
-    ptr->head_size = aligned_list_node_size;
+    ptr->align_shift = get_align_shift(alignment);
+#if NVWA_CMT_PROFILING
+    ptr->alloc_time = get_timestamp();
+#endif
     ptr->magic = CMT_MAGIC;
     {
         fast_mutex_autolock guard{new_ptr_lock};
@@ -217,18 +459,29 @@ void* alloc_mem(size_t size, const context& ctx, is_array_t is_array,
         alloc_list.prev->next = ptr;
         alloc_list.prev = ptr;
         current_mem_alloc += size;
+        ++current_alloc_cnt;
         ++total_mem_alloc_cnt_accum;
+        add_context_alloc(ctx_id, size);
     }
+#if NVWA_CMT_TRACE_EVENTS
+    trace_alloc_event(alloc_event_alloc, usr_ptr, size, ctx_id);
+#endif
     if (new_verbose_flag) {
         fast_mutex_autolock guard{new_output_lock};
         fprintf(new_output_fp, "new%s: allocated %p (size %zu, ",
                 is_array ? "[]" : "", usr_ptr, size);
-        print_context(ptr->ctx, new_output_fp);
+        print_context(ctx_id, new_output_fp);
         fprintf(new_output_fp, ")\n");
     }
     return usr_ptr;
 }
 
+void* alloc_mem(size_t size, const context& ctx, is_array_t is_array,
+                size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+{
+    return alloc_mem(size, intern_context(ctx), is_array, alignment);
+}
+
 void free_mem(void* usr_ptr, is_array_t is_array,
               size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__)
 {
@@ -250,9 +503,17 @@ void free_mem(void* usr_ptr, is_array_t is_array,
                                msg, usr_ptr, ptr->size);
         NVWA_CMT_ERROR_ACTION();
     }
+#if NVWA_CMT_PROFILING
+    uint64_t lifetime = get_timestamp() - ptr->alloc_time;
+#endif
     {
         fast_mutex_autolock guard{new_ptr_lock};
         current_mem_alloc -= ptr->size;
+        --current_alloc_cnt;
+        remove_context_alloc(ptr->ctx_id, ptr->size);
+#if NVWA_CMT_PROFILING
+        add_context_lifetime(ptr->ctx_id, lifetime);
+#endif
         ptr->magic = 0;
         ptr->prev->next = ptr->next;
         ptr->next->prev = ptr->prev;
@@ -263,6 +524,9 @@ void free_mem(void* usr_ptr, is_array_t is_array,
                 "delete%s: freed %p (size %zu, %zu bytes still allocated)\n",
                 is_array ? "[]" : "", usr_ptr, ptr->size, current_mem_alloc);
     }
+#if NVWA_CMT_TRACE_EVENTS
+    trace_alloc_event(alloc_event_free, usr_ptr, ptr->size, ptr->ctx_id);
+#endif
 
     if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
         aligned_free(ptr);
@@ -285,11 +549,12 @@ int check_leaks()
             NVWA_CMT_ERROR_ACTION();
         }
 
-        auto usr_ptr = reinterpret_cast<const char*>(ptr) + ptr->head_size;
+        auto usr_ptr = reinterpret_cast<const char*>(ptr) +
+                       get_head_size(ptr);
         fprintf(new_output_fp, "Leaked object at %p (size %zu, ", usr_ptr,
                 ptr->size);
 
-        print_context(ptr->ctx, new_output_fp);
+        print_context(ptr->ctx_id, new_output_fp);
         fprintf(new_output_fp, ")\n");
 
         ptr = static_cast<alloc_list_t*>(ptr->next);
@@ -302,6 +567,181 @@ int check_leaks()
     return leak_cnt;
 }
 
+alloc_snapshot snapshot_allocations()
+{
+    alloc_snapshot snapshot;
+    size_t capacity = 0;
+    for (;;) {
+        // Reserve memory without the lock, so that only the copying is
+        // done with the lock held; retry if there are more allocations
+        // in the meantime.  The count is read only under the lock.
+        snapshot.reserve(capacity);
+        fast_mutex_autolock guard{new_ptr_lock};
+        if (current_alloc_cnt > snapshot.capacity()) {
+            capacity = current_alloc_cnt + current_alloc_cnt / 8 + 16;
+            continue;
+        }
+        auto ptr = static_cast<alloc_list_t*>(alloc_list.next);
+        while (ptr != &alloc_list) {
+            auto usr_ptr =
+                reinterpret_cast<const char*>(ptr) + get_head_size(ptr);
+            snapshot.push_back({usr_ptr, ptr->size, ptr->ctx_id, {}});
+            ptr = static_cast<alloc_list_t*>(ptr->next);
+        }
+        break;
+    }
+    fill_contexts(snapshot);
+    return snapshot;
+}
+
+void print_alloc_snapshot(const alloc_snapshot& snapshot)
+{
+    size_t total_size = 0;
+    fast_mutex_autolock guard{new_output_lock};
+    for (auto& record : snapshot) {
+        fprintf(new_output_fp, "Allocated object at %p (size %zu, ",
+                record.usr_ptr, record.size);
+        print_context(record.ctx, new_output_fp);
+        fprintf(new_output_fp, ")\n");
+        total_size += record.size;
+    }
+    fprintf(new_output_fp, "*** %zu objects allocated (%zu bytes)\n",
+            snapshot.size(), total_size);
+}
+
+context_stats_list get_context_stats()
+{
+    context_stats_list stats;
+    size_t capacity = 0;
+    for (;;) {
+        // Reserve memory without the lock, as in snapshot_allocations
+        stats.reserve(capacity);
+        fast_mutex_autolock guard{new_ptr_lock};
+        if (context_counter_cnt > stats.capacity()) {
+            capacity = context_counter_cnt;
+            continue;
+        }
+        for (size_t i = 0; i < context_counter_cnt; ++i) {
+            const context_counter_t& counter = context_counters[i];
+            if (counter.total_cnt != 0) {
+                stats.push_back({static_cast<uint32_t>(i), {},
+                                 counter.live_bytes, counter.live_cnt,
+                                 counter.total_cnt, counter.peak_bytes});
+            }
+        }
+        break;
+    }
+    fill_contexts(stats);
+    return stats;
+}
+
+void print_context_stats(const context_stats_list& stats,
+                         const context_stats_list* baseline)
+{
+    context_stats_list sorted_stats(stats);
+    std::sort(sorted_stats.begin(), sorted_stats.end(),
+              [](const context_stats& lhs, const context_stats& rhs) {
+                  return lhs.live_bytes > rhs.live_bytes;
+              });
+    fast_mutex_autolock guard{new_output_lock};
+    for (auto& entry : sorted_stats) {
+        fprintf(new_output_fp,
+                "%zu bytes in %zu objects (peak %zu bytes, %zu allocations",
+                entry.live_bytes, entry.live_cnt, entry.peak_bytes,
+                entry.total_cnt);
+        if (baseline != nullptr) {
+            // The baseline is sorted by the context ID
+            size_t base_bytes = 0;
+            size_t base_cnt = 0;
+            auto it = std::lower_bound(
+                baseline->begin(), baseline->end(), entry.ctx_id,
+                [](const context_stats& base_entry, uint32_t ctx_id) {
+                    return base_entry.ctx_id < ctx_id;
+                });
+            if (it != baseline->end() && it->ctx_id == entry.ctx_id) {
+                base_bytes = it->live_bytes;
+                base_cnt = it->total_cnt;
+            }
+            fprintf(new_output_fp,
+                    "; %+td bytes, %zu allocations since baseline",
+                    static_cast<ptrdiff_t>(entry.live_bytes - base_bytes),
+                    entry.total_cnt - base_cnt);
+        }
+        fprintf(new_output_fp, ") in ");
+        print_context(entry.ctx, new_output_fp);
+        fprintf(new_output_fp, "\n");
+    }
+}
+
+context_profile_list get_context_profiles()
+{
+    context_profile_list profiles;
+#if NVWA_CMT_PROFILING
+    size_t capacity = 0;
+    for (;;) {
+        // Reserve memory without the lock, as in snapshot_allocations
+        profiles.reserve(capacity);
+        fast_mutex_autolock guard{new_ptr_lock};
+        if (context_counter_cnt > profiles.capacity()) {
+            capacity = context_counter_cnt;
+            continue;
+        }
+        for (size_t i = 0; i < context_counter_cnt; ++i) {
+            const context_counter_t& counter = context_counters[i];
+            if (counter.total_cnt == 0) {
+                continue;
+            }
+            profiles.emplace_back();
+            context_profile& profile = profiles.back();
+            profile.ctx_id = static_cast<uint32_t>(i);
+            memcpy(profile.size_hist, counter.size_hist,
+                   sizeof profile.size_hist);
+            memcpy(profile.lifetime_hist, counter.lifetime_hist,
+                   sizeof profile.lifetime_hist);
+        }
+        break;
+    }
+    fill_contexts(profiles);
+#endif
+    return profiles;
+}
+
+void print_context_profiles(const context_profile_list& profiles)
+{
+    static const char* const units[] = {"ns", "us", "ms", "s"};
+    fast_mutex_autolock guard{new_output_lock};
+    for (auto& profile : profiles) {
+        fprintf(new_output_fp, "Profile of ");
+        print_context(profile.ctx, new_output_fp);
+        fprintf(new_output_fp, "\n  Allocation sizes (bytes):\n");
+        for (size_t i = 0; i < context_profile_bucket_cnt; ++i) {
+            if (profile.size_hist[i] == 0) {
+                continue;
+            }
+            uint64_t lower = i == 0 ? 0 : uint64_t(1) << (i - 1);
+            uint64_t upper = i == 0 ? 0 : (uint64_t(1) << (i - 1)) * 2 - 1;
+            fprintf(new_output_fp, "    %llu-%llu: %zu\n",
+                    static_cast<unsigned long long>(lower),
+                    static_cast<unsigned long long>(upper),
+                    profile.size_hist[i]);
+        }
+        fprintf(new_output_fp, "  Lifetimes of freed objects:\n");
+        for (size_t i = 0; i < context_profile_bucket_cnt; ++i) {
+            if (profile.lifetime_hist[i] == 0) {
+                continue;
+            }
+            double upper = i == 0 ? 1 : 2.0 * (uint64_t(1) << (i - 1));
+            size_t unit = 0;
+            while (upper >= 1000 && unit < 3) {
+                upper /= 1000;
+                ++unit;
+            }
+            fprintf(new_output_fp, "    < %.3g %s: %zu\n", upper,
+                    units[unit], profile.lifetime_hist[i]);
+        }
+    }
+}
+
 size_t get_current_mem_alloc()
 {
     return current_mem_alloc;
@@ -321,8 +761,13 @@ memory_trace_counter::memory_trace_counter()
 
 memory_trace_counter::~memory_trace_counter()
 {
-    if (--_S_count == 0 && new_autocheck_flag) {
-        if (check_leaks()) {
+    if (--_S_count == 0) {
+#if NVWA_CMT_PROFILING
+        if (new_profile_report_flag) {
+            print_context_profiles(get_context_profiles());
+        }
+#endif
+        if (new_autocheck_flag && check_leaks()) {
             new_verbose_flag = true;
         }
     }
@@ -332,45 +777,68 @@ NVWA_NAMESPACE_END
 
 void* operator new(size_t size)
 {
-    return operator new(size, get_current_context());
+    void* ptr =
+        NVWA::alloc_mem(size, get_current_context(), alloc_is_not_array);
+    if (ptr) {
+        return ptr;
+    } else {
+        throw std::bad_alloc();
+    }
 }
 
 void* operator new[](size_t size)
 {
-    return operator new[](size, get_current_context());
+    void* ptr = NVWA::alloc_mem(size, get_current_context(), alloc_is_array);
+    if (ptr) {
+        return ptr;
+    } else {
+        throw std::bad_alloc();
+    }
 }
 
 void* operator new(size_t size, const std::nothrow_t&) noexcept
 {
-    return alloc_mem(size, get_current_context(), alloc_is_not_array);
+    return NVWA::alloc_mem(size, get_current_context(), alloc_is_not_array);
 }
 
 void* operator new[](size_t size, const std::nothrow_t&) noexcept
 {
-    return alloc_mem(size, get_current_context(), alloc_is_array);
+    return NVWA::alloc_mem(size, get_current_context(), alloc_is_array);
 }
 
 void* operator new(size_t size, std::align_val_t align_val)
 {
-    return operator new(size, align_val, get_current_context());
+    void* ptr = NVWA::alloc_mem(size, get_current_context(),
+                                alloc_is_not_array, size_t(align_val));
+    if (ptr) {
+        return ptr;
+    } else {
+        throw std::bad_alloc();
+    }
 }
 
 void* operator new[](size_t size, std::align_val_t align_val)
 {
-    return operator new[](size, align_val, get_current_context());
+    void* ptr = NVWA::alloc_mem(size, get_current_context(),
+                                alloc_is_array, size_t(align_val));
+    if (ptr) {
+        return ptr;
+    } else {
+        throw std::bad_alloc();
+    }
 }
 
 void* operator new(size_t size, std::align_val_t align_val,
                    const std::nothrow_t&) noexcept
 {
-    return alloc_mem(size, get_current_context(), alloc_is_not_array,
+    return NVWA::alloc_mem(size, get_current_context(), alloc_is_not_array,
                      size_t(align_val));
 }
 
 void* operator new[](size_t size, std::align_val_t align_val,
                      const std::nothrow_t&) noexcept
 {
-    return alloc_mem(size, get_current_context(), alloc_is_array,
+    return NVWA::alloc_mem(size, get_current_context(), alloc_is_array,
                      size_t(align_val));
 }
 
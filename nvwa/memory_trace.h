@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2022 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2022-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -32,7 +32,7 @@
  * Header file for tracing memory with contextual checkpoints.  The
  * current code requires a C++17-compliant compiler.
  *
- * @date  2022-04-07
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_MEMORY_TRACE_H
@@ -43,37 +43,93 @@
 #endif
 
 #include <stddef.h>             // size_t
+#include <stdint.h>             // uint32_t
 #include <stdio.h>              // FILE
 #include <new>                  // std::align_val_t
+#include <vector>               // std::vector
 #include "_nvwa.h"              // NVWA macros
+#include "malloc_allocator.h"   // nvwa::malloc_allocator
 
 NVWA_NAMESPACE_BEGIN
 
+struct context {
+    const char* file;
+    const char* func;
+};
+
+struct alloc_record {
+    const void* usr_ptr;
+    size_t size;
+    uint32_t ctx_id;
+    context ctx;
+};
+
+// Memory for the snapshot is not traced
+using alloc_snapshot =
+    std::vector<alloc_record, malloc_allocator<alloc_record>>;
+
+struct context_stats {
+    uint32_t ctx_id;
+    context ctx;
+    size_t live_bytes;  // bytes currently allocated in the context
+    size_t live_cnt;    // blocks currently allocated in the context
+    size_t total_cnt;   // accumulated allocations in the context
+    size_t peak_bytes;  // maximum of live_bytes
+};
+
+using context_stats_list =
+    std::vector<context_stats, malloc_allocator<context_stats>>;
+
+// Histograms are recorded only when memory_trace.cpp is compiled with
+// NVWA_CMT_PROFILING defined to non-zero.  Bucket i counts values whose
+// bit width is i, i.e., values in [2**(i-1), 2**i).
+constexpr size_t context_profile_bucket_cnt = 64;
+
+struct context_profile {
+    uint32_t ctx_id;
+    context ctx;
+    size_t size_hist[context_profile_bucket_cnt];      // in bytes
+    size_t lifetime_hist[context_profile_bucket_cnt];  // in nanoseconds
+};
+
+using context_profile_list =
+    std::vector<context_profile, malloc_allocator<context_profile>>;
+
 int check_leaks();
 size_t get_current_mem_alloc();
 size_t get_total_mem_alloc_cnt();
+alloc_snapshot snapshot_allocations();
+void print_alloc_snapshot(const alloc_snapshot& snapshot);
+context_stats_list get_context_stats();
+void print_context_stats(const context_stats_list& stats,
+                         const context_stats_list* baseline = nullptr);
+context_profile_list get_context_profiles();
+void print_context_profiles(const context_profile_list& profiles);
 
 extern bool new_autocheck_flag; // default to true: call check_leaks() on exit
 extern bool new_verbose_flag;   // default to false: no verbose information
 extern FILE* new_output_fp;     // default to stderr: output to console
-
-struct context {
-    const char* file;
-    const char* func;
-};
+extern bool new_profile_report_flag; // default to true: print profiles
+                                     // on exit if profiling is enabled
 
 bool operator==(const context& lhs, const context& rhs);
 bool operator!=(const context& lhs, const context& rhs);
 
+// Returns a dense ID for the context (or 0 for the unknown context),
+// which is the same for equal contexts
+uint32_t intern_context(const context& ctx);
+context get_context(uint32_t ctx_id);
+
 class checkpoint {
 public:
+    explicit checkpoint(uint32_t ctx_id);
     explicit checkpoint(const context& ctx);
     ~checkpoint();
     checkpoint(const checkpoint&) = delete;
     checkpoint& operator=(const checkpoint&) = delete;
 
 private:
-    const context ctx_;
+    const uint32_t ctx_id_;
 };
 
 class memory_trace_counter {
@@ -91,14 +147,20 @@ static memory_trace_counter __memory_trace_count;
 
 NVWA_NAMESPACE_END
 
+// The context is interned only once at each checkpoint
+#define NVWA_MEMORY_CHECKPOINT_IMPL(func)                              \
+    NVWA::checkpoint NVWA_UNIQUE_NAME(memory_trace_checkpoint){        \
+        [](const NVWA::context& ctx) {                                 \
+            static const uint32_t ctx_id = NVWA::intern_context(ctx);  \
+            return ctx_id;                                             \
+        }(NVWA::context{__FILE__, func})}
+
 #ifdef __GNUC__
 #define NVWA_MEMORY_CHECKPOINT()                                 \
-    NVWA::checkpoint NVWA_UNIQUE_NAME(memory_trace_checkpoint){  \
-        NVWA::context{__FILE__, __PRETTY_FUNCTION__}}
+    NVWA_MEMORY_CHECKPOINT_IMPL(__PRETTY_FUNCTION__)
 #else
 #define NVWA_MEMORY_CHECKPOINT()                                 \
-    NVWA::checkpoint NVWA_UNIQUE_NAME(memory_trace_checkpoint){  \
-        NVWA::context{__FILE__, __func__}}
+    NVWA_MEMORY_CHECKPOINT_IMPL(__func__)
 #endif
 
 void* operator new  (std::size_t size,
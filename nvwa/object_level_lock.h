@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2021 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -34,15 +34,26 @@
  * href="http://www.awprofessional.com/articles/article.asp?p=25298">
  * "Multithreading and the C++ Type System"</a> for the ideas behind.
  *
- * @date  2021-08-06
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_OBJECT_LEVEL_LOCK_H
 #define NVWA_OBJECT_LEVEL_LOCK_H
 
+#include <stddef.h>             // size_t
+#include <stdint.h>             // uintptr_t
+#include "c++_features.h"       // HAVE_CXX11_ALIGNAS
 #include "fast_mutex.h"         // nvwa::fast_mutex/_NOTHREADS
 #include "_nvwa.h"              // NVWA_NAMESPACE_*
 
+# ifndef _OBJECT_LEVEL_LOCK_STRIPES
+/**
+ * Macro to control the number of mutexes shared by all objects using
+ * striped_object_level_lock.
+ */
+#   define _OBJECT_LEVEL_LOCK_STRIPES 256
+# endif
+
 NVWA_NAMESPACE_BEGIN
 
 # ifdef _NOTHREADS
@@ -50,7 +61,7 @@ NVWA_NAMESPACE_BEGIN
      * Helper class for object-level locking.  This is the
      * single-threaded implementation.
      */
-    template <class _Host>
+    template <class _Host, class _Mutex = fast_mutex>
     class object_level_lock {
     public:
         /** Type that provides locking/unlocking semantics. */
@@ -61,13 +72,42 @@ NVWA_NAMESPACE_BEGIN
 
         public:
             explicit lock(const object_level_lock& host)
+#   ifndef NDEBUG
+                : _M_host(host)
+#   endif
+            {
+                (void)host;
+            }
             lock(const lock&) = delete;
             lock& operator=(const lock&) = delete;
+#   ifndef NDEBUG
+            // The purpose of this method is allow one to write code
+            // like "assert(guard.get_locked_object() == this)" to
+            // ensure that the locked object is exactly the object being
+            // accessed.
+            const object_level_lock* get_locked_object() const
+            {
+                return &_M_host;
+            }
+#   endif
+        };
+
+        /** Type that provides shared locking/unlocking semantics. */
+        class shared_lock {
+#   ifndef NDEBUG
+            const object_level_lock& _M_host;
+#   endif
+
+        public:
+            explicit shared_lock(const object_level_lock& host)
 #   ifndef NDEBUG
                 : _M_host(host)
 #   endif
             {
+                (void)host;
             }
+            shared_lock(const shared_lock&) = delete;
+            shared_lock& operator=(const shared_lock&) = delete;
 #   ifndef NDEBUG
             // The purpose of this method is allow one to write code
             // like "assert(guard.get_locked_object() == this)" to
@@ -82,14 +122,51 @@ NVWA_NAMESPACE_BEGIN
 
         typedef _Host volatile_type;
     };
+
+    /**
+     * Helper class for object-level locking with mutexes shared among
+     * objects.  This is the single-threaded implementation.
+     */
+    template <class _Host>
+    class striped_object_level_lock {
+    public:
+        /** Type that provides locking/unlocking semantics. */
+        class lock {
+#   ifndef NDEBUG
+            const striped_object_level_lock& _M_host;
+#   endif
+
+        public:
+            explicit lock(const striped_object_level_lock& host)
+#   ifndef NDEBUG
+                : _M_host(host)
+#   endif
+            {
+                (void)host;
+            }
+            lock(const lock&) = delete;
+            lock& operator=(const lock&) = delete;
+#   ifndef NDEBUG
+            const striped_object_level_lock* get_locked_object() const
+            {
+                return &_M_host;
+            }
+#   endif
+        };
+
+        typedef _Host volatile_type;
+    };
 # else
     /**
      * Helper class for object-level locking.  This is the
-     * multi-threaded implementation.
+     * multi-threaded implementation.  The mutex type can be changed to
+     * a reader-writer mutex (like fast_shared_mutex or \c
+     * std::shared_mutex) so that shared_lock can be used for read-only
+     * access.
      */
-    template <class _Host>
+    template <class _Host, class _Mutex = fast_mutex>
     class object_level_lock {
-        mutable fast_mutex _M_mtx;
+        mutable _Mutex _M_mtx;
 
     public:
         // The C++ 1998 Standard required the use of `friend' here, but
@@ -97,17 +174,29 @@ NVWA_NAMESPACE_BEGIN
         // changed.  It is still used here for compatibility with older
         // compilers.
         class lock;
+        class shared_lock;
         friend class lock;
+        friend class shared_lock;
 
         /** Type that provides locking/unlocking semantics. */
         class lock {
             const object_level_lock& _M_host;
 
         public:
+#   if _FAST_MUTEX_PROFILE
+            explicit lock(const object_level_lock& host,
+                          const char* file = _FAST_MUTEX_CALLER_FILE,
+                          int line = _FAST_MUTEX_CALLER_LINE)
+                : _M_host(host)
+            {
+                fast_mutex_impl::lock_at(_M_host._M_mtx, file, line);
+            }
+#   else
             explicit lock(const object_level_lock& host) : _M_host(host)
             {
                 _M_host._M_mtx.lock();
             }
+#   endif
             lock(const lock&) = delete;
             lock& operator=(const lock&) = delete;
             ~lock()
@@ -126,8 +215,129 @@ NVWA_NAMESPACE_BEGIN
 #   endif
         };
 
+        /**
+         * Type that provides shared locking/unlocking semantics.  It
+         * requires the mutex type to have \c lock_shared and \c
+         * unlock_shared.
+         */
+        class shared_lock {
+            const object_level_lock& _M_host;
+
+        public:
+            explicit shared_lock(const object_level_lock& host)
+                : _M_host(host)
+            {
+                _M_host._M_mtx.lock_shared();
+            }
+            shared_lock(const shared_lock&) = delete;
+            shared_lock& operator=(const shared_lock&) = delete;
+            ~shared_lock()
+            {
+                _M_host._M_mtx.unlock_shared();
+            }
+#   ifndef NDEBUG
+            const object_level_lock* get_locked_object() const
+            {
+                return &_M_host;
+            }
+#   endif
+        };
+
+        typedef volatile _Host volatile_type;
+    };
+
+#   if HAVE_CXX11_ALIGNAS
+    static_assert((_OBJECT_LEVEL_LOCK_STRIPES &
+                   (_OBJECT_LEVEL_LOCK_STRIPES - 1)) == 0,
+                  "_OBJECT_LEVEL_LOCK_STRIPES must be a power of two");
+
+    /** Mutex padded to its own cache line. */
+    struct alignas(64) object_lock_stripe {
+        fast_mutex mtx;
+    };
+
+    /**
+     * Gets the number of bits needed to index a power-of-two table.
+     *
+     * @param size  size of the table
+     * @return      base-2 logarithm of \a size
+     */
+    constexpr int get_object_lock_stripe_bits(size_t size)
+    {
+        return size <= 1 ? 0 : 1 + get_object_lock_stripe_bits(size / 2);
+    }
+
+    /**
+     * Gets the mutex for an object from the table shared by all
+     * striped_object_level_lock instances.  The index is taken from the
+     * high bits of a multiplicative hash, as the low bits of the
+     * product would vary only with the low bits of the address, and
+     * objects of a large power-of-two stride would map to few stripes.
+     *
+     * @param ptr  address of the object
+     * @return     reference to the mutex
+     */
+    inline fast_mutex& get_object_lock_stripe(const void* ptr)
+    {
+        static object_lock_stripe stripes[_OBJECT_LEVEL_LOCK_STRIPES];
+        uint64_t hash =
+            static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr) >> 4) *
+            UINT64_C(0x9E3779B97F4A7C15);
+        size_t index = static_cast<size_t>(
+            hash >> (64 - get_object_lock_stripe_bits(
+                              _OBJECT_LEVEL_LOCK_STRIPES)));
+        return stripes[index].mtx;
+    }
+
+    /**
+     * Helper class for object-level locking with mutexes shared among
+     * objects.  This is the multi-threaded implementation.  The object
+     * address is hashed into a global table of mutexes, so that the
+     * class is empty and adds nothing to the size of its derived class.
+     * As unrelated objects may share a mutex, a thread must not hold
+     * locks of two objects at the same time.
+     */
+    template <class _Host>
+    class striped_object_level_lock {
+    public:
+        /** Type that provides locking/unlocking semantics. */
+        class lock {
+            const striped_object_level_lock& _M_host;
+            fast_mutex& _M_mtx;
+
+        public:
+#   if _FAST_MUTEX_PROFILE
+            explicit lock(const striped_object_level_lock& host,
+                          const char* file = _FAST_MUTEX_CALLER_FILE,
+                          int line = _FAST_MUTEX_CALLER_LINE)
+                : _M_host(host), _M_mtx(get_object_lock_stripe(&host))
+            {
+                fast_mutex_impl::lock_at(_M_mtx, file, line);
+            }
+#   else
+            explicit lock(const striped_object_level_lock& host)
+                : _M_host(host), _M_mtx(get_object_lock_stripe(&host))
+            {
+                _M_mtx.lock();
+            }
+#   endif
+            lock(const lock&) = delete;
+            lock& operator=(const lock&) = delete;
+            ~lock()
+            {
+                _M_mtx.unlock();
+            }
+#   ifndef NDEBUG
+            const striped_object_level_lock* get_locked_object() const
+            {
+                return &_M_host;
+            }
+#   endif
+        };
+
         typedef volatile _Host volatile_type;
     };
+#   endif // HAVE_CXX11_ALIGNAS
 # endif // _NOTHREADS
 
 NVWA_NAMESPACE_END
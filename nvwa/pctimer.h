@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2019 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -29,17 +29,26 @@
 /**
  * @file  pctimer.h
  *
- * Function to get a high-resolution timer for Win32/Cygwin/Unix.
+ * Functions to get a high-resolution timer for Win32/Cygwin/Unix.
  *
- * @date  2019-10-10
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_PCTIMER_H
 #define NVWA_PCTIMER_H
 
+#include <stdint.h>             // uint64_t
 #include "_nvwa.h"              // NVWA_NAMESPACE_*/NVWA_WINDOWS
 #include "c++_features.h"       // _NULLPTR
 
+/* C allows static variables only in inline functions with internal
+   linkage. */
+#ifdef __cplusplus
+#define NVWA_PCTIMER_INLINE inline
+#else
+#define NVWA_PCTIMER_INLINE static __inline
+#endif
+
 #if NVWA_WINDOWS
 
 #ifndef _WIN32
@@ -74,11 +83,37 @@ __inline pctimer_t pctimer(void)
     return (double)pcount.QuadPart / (double)pcfreq.QuadPart;
 }
 
+typedef uint64_t pctimer_ns_t;
+
+/**
+ * Gets a monotonic timestamp in integer nanoseconds.
+ *
+ * @return  nanoseconds from an unspecified starting point
+ */
+NVWA_PCTIMER_INLINE pctimer_ns_t pctimer_ns(void)
+{
+    static LARGE_INTEGER pcfreq;
+    static int initflag;
+    LARGE_INTEGER pcount;
+
+    if (!initflag) {
+        QueryPerformanceFrequency(&pcfreq);
+        initflag++;
+    }
+
+    QueryPerformanceCounter(&pcount);
+    /* Split the conversion to avoid overflow */
+    uint64_t count = (uint64_t)pcount.QuadPart;
+    uint64_t freq = (uint64_t)pcfreq.QuadPart;
+    return count / freq * 1000000000 + count % freq * 1000000000 / freq;
+}
+
 NVWA_NAMESPACE_END
 
 #else /* Not Windows */
 
 #include <sys/time.h>
+#include <time.h>
 
 NVWA_NAMESPACE_BEGIN
 
@@ -91,8 +126,191 @@ __inline pctimer_t pctimer(void)
     return (double)tv.tv_sec + (double)tv.tv_usec / 1000000;
 }
 
+typedef uint64_t pctimer_ns_t;
+
+/**
+ * Gets a monotonic timestamp in integer nanoseconds.  The raw monotonic
+ * clock, which is not slewed by NTP, is used where available.
+ *
+ * @return  nanoseconds from an unspecified starting point
+ */
+NVWA_PCTIMER_INLINE pctimer_ns_t pctimer_ns(void)
+{
+#if defined(CLOCK_MONOTONIC_RAW) || defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (pctimer_ns_t)ts.tv_sec * 1000000000 + (pctimer_ns_t)ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, _NULLPTR);
+    return (pctimer_ns_t)tv.tv_sec * 1000000000 +
+           (pctimer_ns_t)tv.tv_usec * 1000;
+#endif
+}
+
 NVWA_NAMESPACE_END
 
 #endif /* NVWA_WINDOWS */
 
+#if (defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))) || \
+    (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+#define NVWA_PCTIMER_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>             // __cpuid/__rdtsc/_mm_lfence
+#else
+#include <cpuid.h>              // __get_cpuid
+#include <x86intrin.h>          // __rdtsc/_mm_lfence
+#endif
+#else
+#define NVWA_PCTIMER_HAS_TSC 0
+#endif
+
+#ifndef NVWA_PCTIMER_CALIBRATION_NS
+/**
+ * Time spent calibrating the time-stamp counter against pctimer_ns, in
+ * nanoseconds.
+ */
+#define NVWA_PCTIMER_CALIBRATION_NS 10000000
+#endif
+
+NVWA_NAMESPACE_BEGIN
+
+typedef uint64_t pctimer_ticks_t;
+
+/**
+ * Checks whether the time-stamp counter runs at a constant rate,
+ * regardless of frequency scaling and sleep states (the "invariant
+ * TSC" CPUID flag).
+ *
+ * @return  non-zero if the time-stamp counter is usable as a clock;
+ *          \c 0 otherwise
+ */
+NVWA_PCTIMER_INLINE int pctimer_has_invariant_tsc(void)
+{
+#if NVWA_PCTIMER_HAS_TSC
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if ((unsigned)regs[0] < 0x80000007) {
+        return 0;
+    }
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#else
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (edx & (1 << 8)) != 0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+#if NVWA_PCTIMER_HAS_TSC
+/**
+ * Calibrates the time-stamp counter against pctimer_ns, which takes
+ * #NVWA_PCTIMER_CALIBRATION_NS nanoseconds.
+ *
+ * @return  the nanoseconds per tick; or \c 0 if the time-stamp counter
+ *          is not usable
+ */
+NVWA_PCTIMER_INLINE double pctimer_calibrate_tsc(void)
+{
+    pctimer_ns_t start_ns, end_ns;
+    uint64_t start_ticks, end_ticks;
+
+    if (!pctimer_has_invariant_tsc()) {
+        return 0;
+    }
+    _mm_lfence();
+    start_ns = pctimer_ns();
+    start_ticks = __rdtsc();
+    do {
+        end_ns = pctimer_ns();
+    } while (end_ns - start_ns < NVWA_PCTIMER_CALIBRATION_NS);
+    end_ticks = __rdtsc();
+    if (end_ticks <= start_ticks) {
+        return 0;
+    }
+    return (double)(end_ns - start_ns) / (double)(end_ticks - start_ticks);
+}
+#endif
+
+/**
+ * Gets the nanoseconds per tick of pctimer_ticks.  The time-stamp
+ * counter is calibrated against pctimer_ns on first use, which takes
+ * #NVWA_PCTIMER_CALIBRATION_NS nanoseconds.  In C++ the calibration is
+ * thread-safe; in C, call it once before starting threads that use
+ * pctimer_ticks, as concurrent first calls may see different results.
+ *
+ * @return  the nanoseconds per tick; or \c 0 if pctimer_ticks falls
+ *          back to pctimer_ns
+ */
+NVWA_PCTIMER_INLINE double pctimer_tick_ns(void)
+{
+#if NVWA_PCTIMER_HAS_TSC
+#ifdef __cplusplus
+    static const double tick_ns = pctimer_calibrate_tsc();
+    return tick_ns;
+#else
+    static double tick_ns;
+    static int initflag;
+
+    if (!initflag) {
+        tick_ns = pctimer_calibrate_tsc();
+        initflag++;
+    }
+    return tick_ns;
+#endif
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Gets a timestamp in ticks with minimal overhead.  The invariant
+ * time-stamp counter is used where available; otherwise it is the same
+ * as pctimer_ns.  Use pctimer_ticks_to_ns to convert the difference of
+ * two timestamps to nanoseconds.
+ *
+ * @return  ticks from an unspecified starting point
+ */
+NVWA_PCTIMER_INLINE pctimer_ticks_t pctimer_ticks(void)
+{
+#if NVWA_PCTIMER_HAS_TSC
+    pctimer_ticks_t ticks;
+    if (pctimer_tick_ns() != 0) {
+        /* Keep the reading from being reordered with the code timed */
+        _mm_lfence();
+        ticks = __rdtsc();
+        _mm_lfence();
+        return ticks;
+    }
+#endif
+    return pctimer_ns();
+}
+
+/**
+ * Converts ticks of pctimer_ticks to nanoseconds.
+ *
+ * @param ticks  number of ticks
+ * @return       number of nanoseconds
+ */
+NVWA_PCTIMER_INLINE pctimer_ns_t pctimer_ticks_to_ns(pctimer_ticks_t ticks)
+{
+    double tick_ns = pctimer_tick_ns();
+    if (tick_ns == 0) {
+        return ticks;
+    }
+    return (pctimer_ns_t)((double)ticks * tick_ns + 0.5);
+}
+
+NVWA_NAMESPACE_END
+
 #endif /* NVWA_PCTIMER_H */
@@ -0,0 +1,98 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+
+
+/**
+ * @file  spin_mutex.h
+ *
+ * A one-byte spinning mutex for protecting small objects.  The current
+ * code requires a C++11-compliant compiler.
+ *
+ * @date  2026-10-16
+ */
+
+#ifndef NVWA_SPIN_MUTEX_H
+#define NVWA_SPIN_MUTEX_H
+
+#include <atomic>               // std::atomic
+#include <thread>               // std::this_thread::yield
+#include "fast_mutex.h"         // _FAST_MUTEX_SPIN_LIMIT/fast_mutex_pause
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+
+NVWA_NAMESPACE_BEGIN
+
+/**
+ * Class for non-reentrant spinning mutexes.  It takes only one byte,
+ * and is suitable to be embedded in small objects (say, as the mutex
+ * type of object_level_lock) when the locks are held very briefly.  A
+ * contended lock spins with exponential backoff for a while, and then
+ * yields the processor until the mutex is released.
+ */
+class spin_mutex {
+    std::atomic<bool> _M_locked;
+
+public:
+    spin_mutex() : _M_locked(false) {}
+    void lock()
+    {
+        while (_M_locked.exchange(true, std::memory_order_acquire)) {
+            int spin_cnt = 1;
+            // Wait with plain loads, which do not take the cache line
+            // exclusively
+            while (_M_locked.load(std::memory_order_relaxed)) {
+                if (spin_cnt <= _FAST_MUTEX_SPIN_LIMIT) {
+                    for (int i = 0; i < spin_cnt; ++i) {
+                        fast_mutex_pause();
+                    }
+                    spin_cnt *= 2;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+    bool try_lock()
+    {
+        return !_M_locked.load(std::memory_order_relaxed) &&
+               !_M_locked.exchange(true, std::memory_order_acquire);
+    }
+    void unlock()
+    {
+        _M_locked.store(false, std::memory_order_release);
+    }
+
+private:
+    spin_mutex(const spin_mutex&) = delete;
+    spin_mutex& operator=(const spin_mutex&) = delete;
+};
+
+static_assert(sizeof(spin_mutex) == 1, "spin_mutex should take one byte");
+
+NVWA_NAMESPACE_END
+
+#endif // NVWA_SPIN_MUTEX_H
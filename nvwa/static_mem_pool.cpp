@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2019 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,16 +31,30 @@
  *
  * Non-template and non-inline code for the `static' memory pool.
  *
- * @date  2019-08-22
+ * @date  2026-10-16
  */
 
 #include "static_mem_pool.h"    // nvwa::static_mem_pool_set
-#include <algorithm>            // std::for_each
+#include <algorithm>            // std::for_each/sort
+#include <iomanip>              // std::setw
+#include <ostream>              // std::ostream
 #include "_nvwa.h"              // NVWA_NAMESPACE_*
 #include "cont_ptr_utils.h"     // nvwa::delete_object
 
 NVWA_NAMESPACE_BEGIN
 
+namespace {
+
+bool block_size_less(const mem_pool_stats& lhs, const mem_pool_stats& rhs)
+{
+    if (lhs.block_size != rhs.block_size) {
+        return lhs.block_size < rhs.block_size;
+    }
+    return lhs.group_id < rhs.group_id;
+}
+
+} /* unnamed namespace */
+
 static_mem_pool_set::static_mem_pool_set()
 {
     _STATIC_MEM_POOL_TRACE(false, "The static_mem_pool_set is created");
@@ -83,6 +97,35 @@ void static_mem_pool_set::recycle()
     }
 }
 
+/**
+ * Asks one static memory pool to recycle unused memory blocks back to
+ * the system.  The lock is held only while the memory pool is looked
+ * up, so that allocations in other memory pools are not blocked for
+ * long.  Since memory pools are never removed from the set, \a index
+ * refers to the same memory pool over time.  Memory pools that are not
+ * thread-safe (grouped ones) are skipped, as this may be called from a
+ * thread other than the one using them.
+ *
+ * @param index  index of the memory pool in the set, in the order the
+ *               memory pools are created
+ * @return       \c true if the memory pool exists; \c false otherwise
+ */
+bool static_mem_pool_set::recycle(size_t index)
+{
+    mem_pool_base* memory_pool_p;
+    {
+        lock guard;
+        if (index >= _M_memory_pool_set.size()) {
+            return false;
+        }
+        memory_pool_p = _M_memory_pool_set[index];
+    }
+    if (memory_pool_p->is_thread_safe()) {
+        memory_pool_p->recycle();
+    }
+    return true;
+}
+
 /**
  * Adds a new memory pool to nvwa#static_mem_pool_set.
  *
@@ -94,4 +137,80 @@ void static_mem_pool_set::add(mem_pool_base* memory_pool_p)
     _M_memory_pool_set.push_back(memory_pool_p);
 }
 
+/**
+ * Gets the counters of all memory pools that provide them.  The lock
+ * is held only while the counters are copied.
+ *
+ * @param[out] result  counters of the memory pools, sorted by block
+ *                     size and group ID
+ */
+void static_mem_pool_set::get_stats(std::vector<mem_pool_stats>& result)
+{
+    result.clear();
+    {
+        lock guard;
+        result.reserve(_M_memory_pool_set.size());
+        container_type::iterator end = _M_memory_pool_set.end();
+        for (container_type::iterator
+                i  = _M_memory_pool_set.begin();
+                i != end; ++i) {
+            mem_pool_stats stats;
+            if ((*i)->get_stats(stats)) {
+                result.push_back(stats);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end(), block_size_less);
+}
+
+/**
+ * Prints the counters of all memory pools.  The output is done after
+ * the counters are copied, without holding any locks.
+ *
+ * @param os      the output stream
+ * @param format  text_format for a table, or json_format for a JSON
+ *                array with one object for each memory pool
+ */
+void static_mem_pool_set::print_stats(std::ostream& os,
+                                      stats_format format)
+{
+    std::vector<mem_pool_stats> pool_stats;
+    get_stats(pool_stats);
+
+    std::vector<mem_pool_stats>::const_iterator end = pool_stats.end();
+    std::vector<mem_pool_stats>::const_iterator i;
+    if (format == json_format) {
+        os << '[';
+        for (i = pool_stats.begin(); i != end; ++i) {
+            if (i != pool_stats.begin()) {
+                os << ',';
+            }
+            os << "\n  {\"block_size\": " << i->block_size
+               << ", \"group_id\": " << i->group_id
+               << ", \"blocks_in_use\": " << i->blocks_in_use
+               << ", \"blocks_free\": " << i->blocks_free
+               << ", \"sys_allocs\": " << i->sys_allocs
+               << ", \"sys_deallocs\": " << i->sys_deallocs
+               << ", \"lock_acquisitions\": " << i->lock_acquisitions
+               << ", \"lock_contentions\": " << i->lock_contentions
+               << '}';
+        }
+        os << "\n]\n";
+        return;
+    }
+
+    os << "    Size  Group      In use        Free  Sys allocs"
+          "  Sys deallocs         Locks   Contended\n";
+    for (i = pool_stats.begin(); i != end; ++i) {
+        os << std::setw(8) << i->block_size
+           << std::setw(7) << i->group_id
+           << std::setw(12) << i->blocks_in_use
+           << std::setw(12) << i->blocks_free
+           << std::setw(12) << i->sys_allocs
+           << std::setw(14) << i->sys_deallocs
+           << std::setw(14) << i->lock_acquisitions
+           << std::setw(12) << i->lock_contentions << '\n';
+    }
+}
+
 NVWA_NAMESPACE_END
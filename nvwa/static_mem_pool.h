@@ -2,7 +2,7 @@
 // vim:tabstop=4:shiftwidth=4:expandtab:
 
 /*
- * Copyright (C) 2004-2021 Wu Yongwei <wuyongwei at gmail dot com>
+ * Copyright (C) 2004-2026 Wu Yongwei <wuyongwei at gmail dot com>
  *
  * This software is provided 'as-is', without any express or implied
  * warranty.  In no event will the authors be held liable for any
@@ -31,12 +31,14 @@
  *
  * Header file for the `static' memory pool.
  *
- * @date  2021-08-01
+ * @date  2026-10-16
  */
 
 #ifndef NVWA_STATIC_MEM_POOL_H
 #define NVWA_STATIC_MEM_POOL_H
 
+#include <functional>           // std::less
+#include <iosfwd>               // std::ostream
 #include <new>                  // std::bad_alloc
 #include <stdexcept>            // std::runtime_error
 #include <vector>               // std::vector
@@ -64,6 +66,33 @@
         ((void)0)
 # endif
 
+/**
+ * @def _STATIC_MEM_POOL_SLAB_SIZE
+ *
+ * Size in bytes of the slabs requested from the system.  Memory blocks
+ * are carved out of slabs, instead of being allocated one by one.  A
+ * slab always contains at least one memory block, so a memory pool with
+ * a block size bigger than this value allocates one block at a time.
+ */
+# ifndef _STATIC_MEM_POOL_SLAB_SIZE
+#   define _STATIC_MEM_POOL_SLAB_SIZE 65536
+# endif
+
+/**
+ * @def _STATIC_MEM_POOL_SLAB_ALIGNMENT
+ *
+ * Alignment of the first memory block in a slab.  It should match the
+ * alignment guaranteed by the system allocation function.
+ */
+# ifndef _STATIC_MEM_POOL_SLAB_ALIGNMENT
+#   ifdef __STDCPP_DEFAULT_NEW_ALIGNMENT__
+#     define _STATIC_MEM_POOL_SLAB_ALIGNMENT \
+              __STDCPP_DEFAULT_NEW_ALIGNMENT__
+#   else
+#     define _STATIC_MEM_POOL_SLAB_ALIGNMENT (sizeof(void*) * 2)
+#   endif
+# endif
+
 NVWA_NAMESPACE_BEGIN
 
 /**
@@ -73,9 +102,17 @@ NVWA_NAMESPACE_BEGIN
 class static_mem_pool_set {
 public:
     typedef class_level_lock<static_mem_pool_set>::lock lock;
+    /** Output formats of the counters of the memory pools. */
+    enum stats_format {
+        text_format,            ///< Human-readable table
+        json_format             ///< JSON array of objects
+    };
     static static_mem_pool_set& instance();
     void recycle();
+    bool recycle(size_t index);
     void add(mem_pool_base* memory_pool_p);
+    void get_stats(std::vector<mem_pool_stats>& result);
+    void print_stats(std::ostream& os, stats_format format = text_format);
 
 private:
     static_mem_pool_set();
@@ -98,10 +135,13 @@ private:
  *              simultaneous accesses to this static_mem_pool will be
  *              protected from each other; otherwise no protection is
  *              given
+ * @param _Backing  backing policy to allocate slabs from the system,
+ *              like nvwa#sys_backing (default), nvwa#huge_page_backing,
+ *              or nvwa#numa_local_backing
  */
-template <size_t _Sz, int _Gid = -1>
+template <size_t _Sz, int _Gid = -1, class _Backing = sys_backing>
 class static_mem_pool : public mem_pool_base {
-    typedef typename class_level_lock<static_mem_pool<_Sz, _Gid>, (_Gid < 0)>
+    typedef typename class_level_lock<static_mem_pool, (_Gid < 0)>
             ::lock lock;
 public:
     /**
@@ -143,14 +183,15 @@ public:
     void* allocate()
     {
         {
-            lock guard;
+            _Counting_lock guard;
             if (_S_memory_block_p) {
                 void* result = _S_memory_block_p;
                 _S_memory_block_p = _S_memory_block_p->_M_next;
+                --_S_free_cnt;
                 return result;
             }
         }
-        return _S_alloc_sys(_S_align(_Sz));
+        return _S_alloc_slab();
     }
     /**
      * Deallocates memory by putting the memory block into the pool.
@@ -160,14 +201,36 @@ public:
     void deallocate(void* ptr)
     {
         assert(ptr != _NULLPTR);
-        lock guard;
+        _Counting_lock guard;
         _Block_list* block = reinterpret_cast<_Block_list*>(ptr);
         block->_M_next = _S_memory_block_p;
         _S_memory_block_p = block;
+        ++_S_free_cnt;
     }
     virtual void recycle() _OVERRIDE;
+    virtual bool get_stats(mem_pool_stats& stats) _OVERRIDE;
+    virtual bool is_thread_safe() const _OVERRIDE
+    {
+        return _Gid < 0;
+    }
 
 private:
+    /** Lock guard that updates the lock counters of the pool. */
+    class _Counting_lock {
+    public:
+        _Counting_lock() : _M_contended(false), _M_guard(_M_contended)
+        {
+            ++_S_lock_cnt;
+            if (_M_contended) {
+                ++_S_contention_cnt;
+            }
+        }
+
+    private:
+        bool _M_contended;
+        lock _M_guard;
+    };
+
     static_mem_pool()
     {
         _STATIC_MEM_POOL_TRACE(true, "static_mem_pool<" << _Sz << ','
@@ -177,84 +240,294 @@ private:
     {
 #   ifdef _DEBUG
         // Empty the pool to avoid false memory leakage alarms.  This is
-        // generally not necessary for release binaries.
-        _Block_list* block = _S_memory_block_p;
-        while (block) {
-            _Block_list* next = block->_M_next;
-            dealloc_sys(block);
-            block = next;
-        }
-        _S_memory_block_p = _NULLPTR;
+        // generally not necessary for release binaries.  Slabs that
+        // still have blocks in use are real leaks, and are kept.
+        size_t free_slab_cnt;
+        _S_release_slabs(_S_take_free_slabs(_S_memory_block_p,
+                                            _S_slab_list_p,
+                                            free_slab_cnt));
 #   endif
         _S_instance_p = _NULLPTR;
         _S_destroyed = true;
         _STATIC_MEM_POOL_TRACE(false, "static_mem_pool<" << _Sz << ','
                                       << _Gid << "> is destroyed");
     }
-    static size_t _S_align(size_t size)
-    {
-        return size >= sizeof(_Block_list) ? size : sizeof(_Block_list);
-    }
+    /** Size of a memory block, able to hold a pointer in the list. */
+    static const size_t _S_block_size =
+        ((_Sz >= sizeof(_Block_list) ? _Sz : sizeof(_Block_list)) +
+         sizeof(_Block_list) - 1) & ~(sizeof(_Block_list) - 1);
+    /** Size of the slab header, keeping the blocks properly aligned. */
+    static const size_t _S_header_size =
+        (sizeof(_Block_list) + _STATIC_MEM_POOL_SLAB_ALIGNMENT - 1) &
+        ~size_t(_STATIC_MEM_POOL_SLAB_ALIGNMENT - 1);
+    /** Slab size wanted, rounded up to the backing granularity. */
+    static const size_t _S_slab_size_wanted =
+        (_STATIC_MEM_POOL_SLAB_SIZE + _Backing::granularity - 1) &
+        ~(_Backing::granularity - 1);
+    /** Number of memory blocks in a slab (at least one). */
+    static const size_t _S_blocks_per_slab =
+        _S_slab_size_wanted >= _S_header_size + _S_block_size * 2
+            ? (_S_slab_size_wanted - _S_header_size) / _S_block_size
+            : 1;
+    /** Size of a slab requested from the system. */
+    static const size_t _S_slab_size =
+        _S_header_size + _S_block_size * _S_blocks_per_slab;
+
+    static void* _S_alloc_slab();
+    static _Block_list* _S_take_free_slabs(_Block_list*& block_list,
+                                           _Block_list*& slab_list,
+                                           size_t& free_slab_cnt);
+    static void  _S_release_slabs(_Block_list* slab_list);
     static void* _S_alloc_sys(size_t size);
     static static_mem_pool* _S_create_instance();
 
     static bool _S_destroyed;
     static static_mem_pool* _S_instance_p;
     static mem_pool_base::_Block_list* _S_memory_block_p;
+    static mem_pool_base::_Block_list* _S_slab_list_p;
+    static size_t _S_total_cnt;
+    static size_t _S_free_cnt;
+    static size_t _S_sys_alloc_cnt;
+    static size_t _S_sys_dealloc_cnt;
+    static size_t _S_lock_cnt;
+    static size_t _S_contention_cnt;
 
     /* Forbid their use */
     static_mem_pool(const static_mem_pool&) _DELETED;
     const static_mem_pool& operator=(const static_mem_pool&) _DELETED;
 };
 
-template <size_t _Sz, int _Gid> bool
-        static_mem_pool<_Sz, _Gid>::_S_destroyed = false;
-template <size_t _Sz, int _Gid> mem_pool_base::_Block_list*
-        static_mem_pool<_Sz, _Gid>::_S_memory_block_p = _NULLPTR;
-template <size_t _Sz, int _Gid> static_mem_pool<_Sz, _Gid>*
-        static_mem_pool<_Sz, _Gid>::_S_instance_p = _S_create_instance();
+template <size_t _Sz, int _Gid, class _Backing>
+bool static_mem_pool<_Sz, _Gid, _Backing>::_S_destroyed = false;
+template <size_t _Sz, int _Gid, class _Backing>
+mem_pool_base::_Block_list*
+        static_mem_pool<_Sz, _Gid, _Backing>::_S_memory_block_p = _NULLPTR;
+template <size_t _Sz, int _Gid, class _Backing>
+mem_pool_base::_Block_list*
+        static_mem_pool<_Sz, _Gid, _Backing>::_S_slab_list_p = _NULLPTR;
+template <size_t _Sz, int _Gid, class _Backing>
+size_t static_mem_pool<_Sz, _Gid, _Backing>::_S_total_cnt = 0;
+template <size_t _Sz, int _Gid, class _Backing>
+size_t static_mem_pool<_Sz, _Gid, _Backing>::_S_free_cnt = 0;
+template <size_t _Sz, int _Gid, class _Backing>
+size_t static_mem_pool<_Sz, _Gid, _Backing>::_S_sys_alloc_cnt = 0;
+template <size_t _Sz, int _Gid, class _Backing>
+size_t static_mem_pool<_Sz, _Gid, _Backing>::_S_sys_dealloc_cnt = 0;
+template <size_t _Sz, int _Gid, class _Backing>
+size_t static_mem_pool<_Sz, _Gid, _Backing>::_S_lock_cnt = 0;
+template <size_t _Sz, int _Gid, class _Backing>
+size_t static_mem_pool<_Sz, _Gid, _Backing>::_S_contention_cnt = 0;
+template <size_t _Sz, int _Gid, class _Backing>
+static_mem_pool<_Sz, _Gid, _Backing>*
+        static_mem_pool<_Sz, _Gid, _Backing>::_S_instance_p =
+                _S_create_instance();
 
 /**
- * Recycles half of the free memory blocks in the memory pool to the
- * system.  It is called when a memory request to the system (in other
- * instances of the static memory pool) fails.
+ * Recycles the fully free slabs in the memory pool to the system.  It
+ * is called when a memory request to the system (in other instances of
+ * the static memory pool) fails.  The free list and the slab list are
+ * detached under the pool lock, and searched for free slabs without
+ * it, so that allocations from the pool are not stalled while a long
+ * free list is sorted.  Blocks that are not returned to the system are
+ * then spliced back.
  */
-template <size_t _Sz, int _Gid>
-void static_mem_pool<_Sz, _Gid>::recycle()
+template <size_t _Sz, int _Gid, class _Backing>
+void static_mem_pool<_Sz, _Gid, _Backing>::recycle()
 {
-    // Only here the global lock in static_mem_pool_set is obtained
+    // Only here the global lock in static_mem_pool_set may be obtained
     // before the pool-specific lock.  However, no race conditions are
     // found so far.
+    _Block_list* block_list;
+    _Block_list* slab_list;
+    {
+        _Counting_lock guard;
+        block_list = _S_memory_block_p;
+        slab_list = _S_slab_list_p;
+        _S_memory_block_p = _NULLPTR;
+        _S_slab_list_p = _NULLPTR;
+    }
+
+    size_t free_slab_cnt;
+    _Block_list* free_slabs =
+            _S_take_free_slabs(block_list, slab_list, free_slab_cnt);
+    _Block_list** block_tail = &block_list;
+    while (*block_tail) {
+        block_tail = &(*block_tail)->_M_next;
+    }
+    _Block_list** slab_tail = &slab_list;
+    while (*slab_tail) {
+        slab_tail = &(*slab_tail)->_M_next;
+    }
+
+    {
+        _Counting_lock guard;
+        *block_tail = _S_memory_block_p;
+        _S_memory_block_p = block_list;
+        *slab_tail = _S_slab_list_p;
+        _S_slab_list_p = slab_list;
+        _S_total_cnt -= free_slab_cnt * _S_blocks_per_slab;
+        _S_free_cnt -= free_slab_cnt * _S_blocks_per_slab;
+        _S_sys_dealloc_cnt += free_slab_cnt;
+    }
+    _S_release_slabs(free_slabs);
+    _STATIC_MEM_POOL_TRACE(false, "static_mem_pool<" << _Sz << ','
+                                  << _Gid << "> is recycled");
+}
+
+/**
+ * Gets the counters of the memory pool.  Acquisition of the lock here
+ * is not counted.
+ *
+ * @param[out] stats  snapshot of the counters
+ * @return            \c true
+ */
+template <size_t _Sz, int _Gid, class _Backing>
+bool static_mem_pool<_Sz, _Gid, _Backing>::get_stats(mem_pool_stats& stats)
+{
     lock guard;
-    _Block_list* block = _S_memory_block_p;
-    while (block) {
-        if (_Block_list* temp = block->_M_next) {
-            _Block_list* next = temp->_M_next;
-            block->_M_next = next;
-            dealloc_sys(temp);
+    stats.block_size = _S_block_size;
+    stats.group_id = _Gid;
+    stats.blocks_in_use = _S_total_cnt - _S_free_cnt;
+    stats.blocks_free = _S_free_cnt;
+    stats.sys_allocs = _S_sys_alloc_cnt;
+    stats.sys_deallocs = _S_sys_dealloc_cnt;
+    stats.lock_acquisitions = _S_lock_cnt;
+    stats.lock_contentions = _S_contention_cnt;
+    return true;
+}
+
+/**
+ * Allocates a new slab from the system, and carves it into memory
+ * blocks.  The first block is returned to the caller, and the rest are
+ * threaded onto the free list in one pass.
+ *
+ * @return  pointer to allocated memory if successful; null otherwise
+ */
+template <size_t _Sz, int _Gid, class _Backing>
+void* static_mem_pool<_Sz, _Gid, _Backing>::_S_alloc_slab()
+{
+    char* slab = static_cast<char*>(_S_alloc_sys(_S_slab_size));
+    if (!slab) {
+        return _NULLPTR;
+    }
+    char* result = slab + _S_header_size;
+    _Block_list* first = _NULLPTR;
+    _Block_list* last = _NULLPTR;
+    if (_S_blocks_per_slab > 1) {
+        char* block = result + _S_block_size;
+        first = reinterpret_cast<_Block_list*>(block);
+        for (size_t i = 2; i < _S_blocks_per_slab; ++i) {
+            char* next = block + _S_block_size;
+            reinterpret_cast<_Block_list*>(block)->_M_next =
+                    reinterpret_cast<_Block_list*>(next);
             block = next;
+        }
+        last = reinterpret_cast<_Block_list*>(block);
+    }
+
+    _Counting_lock guard;
+    _Block_list* slab_header = reinterpret_cast<_Block_list*>(slab);
+    slab_header->_M_next = _S_slab_list_p;
+    _S_slab_list_p = slab_header;
+    _S_total_cnt += _S_blocks_per_slab;
+    _S_free_cnt += _S_blocks_per_slab - 1;
+    ++_S_sys_alloc_cnt;
+    if (last) {
+        last->_M_next = _S_memory_block_p;
+        _S_memory_block_p = first;
+    }
+    return result;
+}
+
+/**
+ * Takes the slabs whose blocks are all in a free list out of a slab
+ * list, removing their blocks from the free list.  Both lists are
+ * sorted by address first, so that the blocks can be matched to their
+ * slabs in a single pass without extra memory.  The remaining free list
+ * stays sorted, which also improves the locality of subsequent
+ * allocations.  No lock is needed if the lists are not shared.
+ *
+ * @param[in,out] block_list     the free list
+ * @param[in,out] slab_list      the slab list
+ * @param[out]    free_slab_cnt  number of slabs taken
+ * @return                       the list of slabs taken
+ */
+template <size_t _Sz, int _Gid, class _Backing>
+mem_pool_base::_Block_list*
+static_mem_pool<_Sz, _Gid, _Backing>::_S_take_free_slabs(
+        _Block_list*& block_list,
+        _Block_list*& slab_list,
+        size_t& free_slab_cnt)
+{
+    _Block_list* free_slabs = _NULLPTR;
+    free_slab_cnt = 0;
+    if (!block_list) {
+        return free_slabs;
+    }
+    block_list = sort_block_list(block_list);
+    slab_list = sort_block_list(slab_list);
+
+    std::less<const char*> less;
+    _Block_list** block_link = &block_list;
+    _Block_list** slab_link = &slab_list;
+    while (*slab_link && *block_link) {
+        _Block_list* slab = *slab_link;
+        const char* slab_end = reinterpret_cast<const char*>(slab) +
+                               _S_slab_size;
+        _Block_list** link = block_link;
+        size_t free_cnt = 0;
+        while (*link && less(reinterpret_cast<const char*>(*link),
+                             slab_end)) {
+            link = &(*link)->_M_next;
+            ++free_cnt;
+        }
+        if (free_cnt == _S_blocks_per_slab) {
+            *block_link = *link;
+            *slab_link = slab->_M_next;
+            slab->_M_next = free_slabs;
+            free_slabs = slab;
+            ++free_slab_cnt;
         } else {
-            break;
+            block_link = link;
+            slab_link = &slab->_M_next;
         }
     }
-    _STATIC_MEM_POOL_TRACE(false, "static_mem_pool<" << _Sz << ','
-                                  << _Gid << "> is recycled");
+    return free_slabs;
+}
+
+/**
+ * Returns slabs to the system.
+ *
+ * @param slab_list  list of slabs to return
+ */
+template <size_t _Sz, int _Gid, class _Backing>
+void static_mem_pool<_Sz, _Gid, _Backing>::_S_release_slabs(
+        _Block_list* slab_list)
+{
+    while (slab_list) {
+        _Block_list* next = slab_list->_M_next;
+        _Backing::deallocate(slab_list, _S_slab_size);
+        slab_list = next;
+    }
 }
 
-template <size_t _Sz, int _Gid>
-void* static_mem_pool<_Sz, _Gid>::_S_alloc_sys(size_t size)
+template <size_t _Sz, int _Gid, class _Backing>
+void* static_mem_pool<_Sz, _Gid, _Backing>::_S_alloc_sys(size_t size)
 {
+    // Get the instance first, as it acquires the same lock
+    static_mem_pool_set& pool_set = static_mem_pool_set::instance();
     static_mem_pool_set::lock guard;
-    void* result = mem_pool_base::alloc_sys(size);
+    void* result = _Backing::allocate(size);
     if (!result) {
-        static_mem_pool_set::instance().recycle();
-        result = mem_pool_base::alloc_sys(size);
+        pool_set.recycle();
+        result = _Backing::allocate(size);
     }
     return result;
 }
 
-template <size_t _Sz, int _Gid>
-static_mem_pool<_Sz, _Gid>* static_mem_pool<_Sz, _Gid>::_S_create_instance()
+template <size_t _Sz, int _Gid, class _Backing>
+static_mem_pool<_Sz, _Gid, _Backing>*
+static_mem_pool<_Sz, _Gid, _Backing>::_S_create_instance()
 {
     if (_S_destroyed) {
         throw std::runtime_error("dead reference detected");
@@ -0,0 +1,235 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+/**
+ * @file  static_mem_pool_trimmer.cpp
+ *
+ * Code for the background trimmer of static memory pools.  The current
+ * code requires a C++11-compliant compiler.
+ *
+ * @date  2026-10-16
+ */
+
+#include "static_mem_pool_trimmer.h"    // nvwa::static_mem_pool_trimmer
+#include <stdio.h>              // FILE/fopen/fclose/fscanf
+#include "_nvwa.h"              // NVWA_NAMESPACE_*/NVWA_LINUX
+#include "static_mem_pool.h"    // nvwa::static_mem_pool_set
+
+#if NVWA_LINUX
+#include <unistd.h>             // sysconf
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>             // malloc_trim
+#endif
+
+NVWA_NAMESPACE_BEGIN
+
+namespace {
+
+/**
+ * Returns the free memory in the heap to the system.  Slabs of the
+ * default backing are small enough to be carved out of the heap, and
+ * the C library would keep them after they are freed, so that the
+ * memory usage would not drop after recycling.
+ */
+void release_heap_memory()
+{
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+#if NVWA_LINUX
+
+/**
+ * Reads an unsigned number at the start of a file.
+ *
+ * @param path  path of the file
+ * @return      the number; or 0 if it cannot be read
+ */
+size_t read_number(const char* path)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return 0;
+    }
+    unsigned long long value = 0;
+    if (fscanf(fp, "%llu", &value) != 1) {
+        value = 0;
+    }
+    fclose(fp);
+    return static_cast<size_t>(value);
+}
+#endif
+
+} /* unnamed namespace */
+
+/**
+ * Constructor.  It starts the trimming thread.
+ *
+ * @param high_water  memory usage in bytes above which the memory pools
+ *                    are trimmed
+ * @param interval    interval between checks of the memory usage
+ * @param usage       function to get the memory usage in bytes, like
+ *                    #process_rss (default), #cgroup_memory_usage, or a
+ *                    user-provided one
+ */
+static_mem_pool_trimmer::static_mem_pool_trimmer(
+        size_t high_water,
+        std::chrono::milliseconds interval,
+        usage_func usage)
+    : _M_high_water(high_water)
+    , _M_interval(interval)
+    , _M_usage(usage)
+    , _M_trim_count(0)
+    , _M_stopping(false)
+{
+    static_mem_pool_set::instance();  // Force its creation
+    _M_thread = std::thread(&static_mem_pool_trimmer::run, this);
+}
+
+/**
+ * Destructor.  It stops the trimming thread.
+ */
+static_mem_pool_trimmer::~static_mem_pool_trimmer()
+{
+    stop();
+}
+
+/**
+ * Stops the trimming thread and waits for it to exit.
+ */
+void static_mem_pool_trimmer::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_M_mtx);
+        _M_stopping = true;
+    }
+    _M_cv.notify_one();
+    if (_M_thread.joinable()) {
+        _M_thread.join();
+    }
+}
+
+/**
+ * Makes one trimming pass if the memory usage is above the high-water
+ * mark.  The memory pools are recycled one at a time, and the freed
+ * heap memory is returned to the system after each, until the usage
+ * drops to the high-water mark.  It is called in the trimming thread,
+ * but can also be called directly.
+ *
+ * @return  \c true if any memory pool is asked to recycle; \c false
+ *          otherwise
+ */
+bool static_mem_pool_trimmer::trim()
+{
+    if (_M_usage() <= _M_high_water) {
+        return false;
+    }
+    static_mem_pool_set& pool_set = static_mem_pool_set::instance();
+    for (size_t i = 0; pool_set.recycle(i); ++i) {
+        release_heap_memory();
+        if (_M_usage() <= _M_high_water) {
+            break;
+        }
+    }
+    std::lock_guard<std::mutex> guard(_M_mtx);
+    ++_M_trim_count;
+    return true;
+}
+
+/**
+ * Gets the number of trimming passes made.
+ *
+ * @return  the count of trimming passes
+ */
+size_t static_mem_pool_trimmer::get_trim_count() const
+{
+    std::lock_guard<std::mutex> guard(_M_mtx);
+    return _M_trim_count;
+}
+
+/**
+ * Gets the resident set size of the current process.
+ *
+ * @return  resident set size in bytes; or 0 if it is unknown (the
+ *          memory pools are then never trimmed)
+ */
+size_t static_mem_pool_trimmer::process_rss()
+{
+#if NVWA_LINUX
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp == nullptr) {
+        return 0;
+    }
+    unsigned long long total_pages = 0;
+    unsigned long long resident_pages = 0;
+    if (fscanf(fp, "%llu %llu", &total_pages, &resident_pages) != 2) {
+        resident_pages = 0;
+    }
+    fclose(fp);
+    return static_cast<size_t>(resident_pages) *
+           static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Gets the memory usage of the current cgroup, which includes the page
+ * cache and is what the cgroup memory limit is applied to.
+ *
+ * @return  memory usage in bytes; or 0 if it is unknown (the memory
+ *          pools are then never trimmed)
+ */
+size_t static_mem_pool_trimmer::cgroup_memory_usage()
+{
+#if NVWA_LINUX
+    size_t usage = read_number("/sys/fs/cgroup/memory.current");
+    if (usage == 0) {
+        // cgroup v1
+        usage = read_number(
+            "/sys/fs/cgroup/memory/memory.usage_in_bytes");
+    }
+    return usage;
+#else
+    return 0;
+#endif
+}
+
+void static_mem_pool_trimmer::run()
+{
+    std::unique_lock<std::mutex> guard(_M_mtx);
+    while (!_M_cv.wait_for(guard, _M_interval,
+                           [this] { return _M_stopping; })) {
+        guard.unlock();
+        trim();
+        guard.lock();
+    }
+}
+
+NVWA_NAMESPACE_END
@@ -0,0 +1,101 @@
+// -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// vim:tabstop=4:shiftwidth=4:expandtab:
+
+/*
+ * Copyright (C) 2026 Wu Yongwei <wuyongwei at gmail dot com>
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty.  In no event will the authors be held liable for any
+ * damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute
+ * it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must
+ *    not claim that you wrote the original software.  If you use this
+ *    software in a product, an acknowledgement in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must
+ *    not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source
+ *    distribution.
+ *
+ * This file is part of Stones of Nvwa:
+ *      https://github.com/adah1972/nvwa
+ *
+ */
+/**
+ * @file  static_mem_pool_trimmer.h
+ *
+ * Header file for a background trimmer that returns free memory in
+ * static memory pools to the system under memory pressure.  The
+ * current code requires a C++11-compliant compiler.
+ *
+ * @date  2026-10-16
+ */
+
+#ifndef NVWA_STATIC_MEM_POOL_TRIMMER_H
+#define NVWA_STATIC_MEM_POOL_TRIMMER_H
+
+#include <chrono>               // std::chrono::milliseconds
+#include <condition_variable>   // std::condition_variable
+#include <functional>           // std::function
+#include <mutex>                // std::mutex
+#include <thread>               // std::thread
+#include <stddef.h>             // size_t
+#include "_nvwa.h"              // NVWA_NAMESPACE_*
+
+NVWA_NAMESPACE_BEGIN
+
+/**
+ * Background trimmer of static memory pools.  A thread checks the
+ * memory usage periodically, and, when it is above the high-water mark,
+ * asks the static memory pools to recycle their free slabs one by one,
+ * until the usage falls below the mark.  At most one pass is made in
+ * each interval.  The lock of nvwa#static_mem_pool_set is held only
+ * briefly for each memory pool.  Only the memory pools protected by
+ * locks (those with a negative group ID) are trimmed, as the grouped
+ * ones may be used only by their own threads.
+ *
+ * The trimmer should be destroyed (or stopped) before the static memory
+ * pools are destroyed at program exit.
+ */
+class static_mem_pool_trimmer {
+public:
+    /** Type of the function to get the memory usage in bytes. */
+    typedef std::function<size_t()> usage_func;
+
+    static_mem_pool_trimmer(size_t high_water,
+                            std::chrono::milliseconds interval =
+                                std::chrono::milliseconds(1000),
+                            usage_func usage = process_rss);
+    ~static_mem_pool_trimmer();
+
+    void stop();
+    bool trim();
+    size_t get_trim_count() const;
+
+    static size_t process_rss();
+    static size_t cgroup_memory_usage();
+
+private:
+    void run();
+
+    size_t                    _M_high_water;
+    std::chrono::milliseconds _M_interval;
+    usage_func                _M_usage;
+    size_t                    _M_trim_count;
+    bool                      _M_stopping;
+    mutable std::mutex        _M_mtx;
+    std::condition_variable   _M_cv;
+    std::thread               _M_thread;
+
+    static_mem_pool_trimmer(const static_mem_pool_trimmer&) = delete;
+    static_mem_pool_trimmer& operator=(const static_mem_pool_trimmer&)
+        = delete;
+};
+
+NVWA_NAMESPACE_END
+
+#endif // NVWA_STATIC_MEM_POOL_TRIMMER_H
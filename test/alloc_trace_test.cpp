@@ -0,0 +1,111 @@
+#include "nvwa/alloc_trace.h"
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <boost/test/unit_test.hpp>
+
+using namespace boost::unit_test_framework;
+
+namespace {
+
+const char* TRACE_FILE = "alloc_trace_test.bin";
+
+void record_events(int base, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        char* ptr = reinterpret_cast<char*>(0x1000) + base + i * 16;
+        nvwa::trace_alloc_event(nvwa::alloc_event_alloc, ptr, i + 1, 7);
+        nvwa::trace_alloc_event(nvwa::alloc_event_free, ptr, i + 1, 7);
+    }
+}
+
+} /* unnamed namespace */
+
+BOOST_AUTO_TEST_CASE(alloc_trace_test)
+{
+    // Not recorded, as tracing is not started
+    record_events(0, 10);
+
+    const int count = 1000;
+    BOOST_REQUIRE(nvwa::start_alloc_trace(TRACE_FILE, 4 * count,
+                                          std::chrono::milliseconds(1)));
+    BOOST_CHECK(!nvwa::start_alloc_trace(TRACE_FILE));
+    std::thread thread1(record_events, 0, count);
+    std::thread thread2(record_events, 0x100000, count);
+    thread1.join();
+    thread2.join();
+    nvwa::stop_alloc_trace();
+    BOOST_CHECK_EQUAL(nvwa::get_alloc_trace_drop_count(), 0U);
+
+    // Append an incomplete record, which should be ignored
+    FILE* fp = fopen(TRACE_FILE, "ab");
+    BOOST_REQUIRE(fp != nullptr);
+    fputs("partial", fp);
+    fclose(fp);
+
+    std::vector<nvwa::alloc_event> events;
+    BOOST_REQUIRE(nvwa::read_alloc_trace(TRACE_FILE, events));
+    remove(TRACE_FILE);
+    BOOST_REQUIRE_EQUAL(events.size(), 4U * count);
+
+    // Events are sorted by time, and are matched
+    uint64_t last_timestamp = 0;
+    std::map<uint16_t, uint64_t> last_timestamps;
+    std::map<uint64_t, uint64_t> live_sizes;
+    for (auto& evt : events) {
+        BOOST_CHECK_EQUAL(evt.id, 7U);
+        BOOST_CHECK(evt.timestamp >= last_timestamp);
+        last_timestamp = evt.timestamp;
+        last_timestamps[evt.thread] = evt.timestamp;
+        if (evt.type == nvwa::alloc_event_alloc) {
+            live_sizes[evt.address] = evt.size;
+        } else {
+            BOOST_CHECK_EQUAL(evt.type, nvwa::alloc_event_free);
+            BOOST_CHECK_EQUAL(live_sizes[evt.address], evt.size);
+            live_sizes.erase(evt.address);
+        }
+    }
+    BOOST_CHECK(live_sizes.empty());
+    BOOST_CHECK_EQUAL(last_timestamps.size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(read_alloc_trace_test)
+{
+    std::vector<nvwa::alloc_event> events(1);
+    BOOST_CHECK(!nvwa::read_alloc_trace("no_such_trace.bin", events));
+    BOOST_CHECK(events.empty());
+
+    // Files of another format are rejected
+    FILE* fp = fopen(TRACE_FILE, "wb");
+    BOOST_REQUIRE(fp != nullptr);
+    uint32_t header[2] = {1, sizeof(nvwa::alloc_event)};
+    fwrite("NVWAXXXX", 8, 1, fp);
+    fwrite(header, sizeof header, 1, fp);
+    fclose(fp);
+    BOOST_CHECK(!nvwa::read_alloc_trace(TRACE_FILE, events));
+
+    // Extra bytes of larger records are skipped
+    fp = fopen(TRACE_FILE, "wb");
+    BOOST_REQUIRE(fp != nullptr);
+    header[1] = sizeof(nvwa::alloc_event) + 8;
+    fwrite("NVWAATRC", 8, 1, fp);
+    fwrite(header, sizeof header, 1, fp);
+    for (uint64_t timestamp : {200, 100}) {
+        nvwa::alloc_event event{};
+        event.timestamp = timestamp;
+        event.type = nvwa::alloc_event_alloc;
+        uint64_t extra = ~UINT64_C(0);
+        fwrite(&event, sizeof event, 1, fp);
+        fwrite(&extra, sizeof extra, 1, fp);
+    }
+    fclose(fp);
+    BOOST_REQUIRE(nvwa::read_alloc_trace(TRACE_FILE, events));
+    remove(TRACE_FILE);
+    BOOST_REQUIRE_EQUAL(events.size(), 2U);
+    BOOST_CHECK_EQUAL(events[0].timestamp, 100U);
+    BOOST_CHECK_EQUAL(events[1].timestamp, 200U);
+    BOOST_CHECK_EQUAL(events[1].type, nvwa::alloc_event_alloc);
+}
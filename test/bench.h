@@ -0,0 +1,60 @@
+#ifndef NVWA_TEST_BENCH_H
+#define NVWA_TEST_BENCH_H
+
+#include <stddef.h>             // size_t
+#include <functional>           // std::function
+
+namespace bench {
+
+/**
+ * Type of a benchmark body.  It shall perform the measured operation
+ * exactly \a iterations times; the harness divides the elapsed time by
+ * this number to get the cost per operation.
+ */
+typedef std::function<void(size_t iterations)> body_t;
+
+/**
+ * Registers a benchmark.  Normally used via #NVWA_BENCHMARK.
+ *
+ * @param name  name of the benchmark, shown in the report and matched
+ *              against the command-line filters
+ * @param body  the benchmark body
+ * @return      \c true (so that it can initialize a static variable)
+ */
+bool register_benchmark(const char* name, body_t body);
+
+/**
+ * Prevents the compiler from optimizing away a computed value.
+ *
+ * @param value  the value to keep
+ */
+template <typename _Tp>
+inline void do_not_optimize(const _Tp& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+} // namespace bench
+
+#define NVWA_BENCH_CONCAT_(x, y) x##y
+#define NVWA_BENCH_CONCAT(x, y) NVWA_BENCH_CONCAT_(x, y)
+
+/**
+ * Defines and registers a benchmark.  The body follows the macro and
+ * can use the \c size_t parameter \c iterations.
+ *
+ * @param name  identifier naming the benchmark
+ */
+#define NVWA_BENCHMARK(name) \
+    static void NVWA_BENCH_CONCAT(bench_, name)(size_t iterations); \
+    static bool NVWA_BENCH_CONCAT(bench_registered_, name) = \
+        bench::register_benchmark(#name, \
+                                  NVWA_BENCH_CONCAT(bench_, name)); \
+    static void NVWA_BENCH_CONCAT(bench_, name)(size_t iterations)
+
+#endif // NVWA_TEST_BENCH_H
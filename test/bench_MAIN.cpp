@@ -0,0 +1,305 @@
+#include "bench.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "nvwa/pctimer.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define NVWA_BENCH_HAS_PERF 1
+#else
+#define NVWA_BENCH_HAS_PERF 0
+#endif
+
+namespace {
+
+struct options {
+    size_t repetitions = 21;
+    uint64_t min_rep_ns = 10000000;     // 10 ms
+    uint64_t warm_up_ns = 50000000;     // 50 ms
+    bool use_perf = false;
+    std::vector<std::string> filters;
+};
+
+std::vector<std::pair<const char*, bench::body_t>>& get_registry()
+{
+    static std::vector<std::pair<const char*, bench::body_t>> registry;
+    return registry;
+}
+
+uint64_t time_body(const bench::body_t& body, size_t iterations)
+{
+    nvwa::pctimer_ticks_t start = nvwa::pctimer_ticks();
+    body(iterations);
+    nvwa::pctimer_ticks_t end = nvwa::pctimer_ticks();
+    return nvwa::pctimer_ticks_to_ns(end - start);
+}
+
+#if NVWA_BENCH_HAS_PERF
+
+// Hardware counters measured with --perf, read as one group
+const uint64_t perf_counter_config[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+};
+const size_t perf_counter_cnt =
+    sizeof perf_counter_config / sizeof perf_counter_config[0];
+
+class perf_counters {
+public:
+    perf_counters()
+    {
+        for (size_t i = 0; i < perf_counter_cnt; ++i) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = perf_counter_config[i];
+            attr.disabled = (i == 0);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int fd = static_cast<int>(
+                syscall(SYS_perf_event_open, &attr, 0, -1,
+                        i == 0 ? -1 : _M_fds[0], 0));
+            if (fd < 0) {
+                close_all();
+                return;
+            }
+            _M_fds.push_back(fd);
+        }
+    }
+    ~perf_counters()
+    {
+        close_all();
+    }
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    bool is_open() const
+    {
+        return !_M_fds.empty();
+    }
+    void start()
+    {
+        ioctl(_M_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(_M_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    bool stop(uint64_t (&values)[perf_counter_cnt])
+    {
+        ioctl(_M_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t buffer[1 + perf_counter_cnt];
+        if (read(_M_fds[0], buffer, sizeof buffer) !=
+                static_cast<ssize_t>(sizeof buffer) ||
+            buffer[0] != perf_counter_cnt) {
+            return false;
+        }
+        std::copy(buffer + 1, buffer + 1 + perf_counter_cnt, values);
+        return true;
+    }
+
+private:
+    void close_all()
+    {
+        for (int fd : _M_fds) {
+            close(fd);
+        }
+        _M_fds.clear();
+    }
+
+    std::vector<int> _M_fds;
+};
+
+#endif // NVWA_BENCH_HAS_PERF
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+void print_header(const options& opts)
+{
+    double tick_ns = nvwa::pctimer_tick_ns();
+    if (tick_ns != 0) {
+        printf("Timer: TSC, %.4f ns/tick\n", tick_ns);
+    } else {
+        printf("Timer: pctimer_ns\n");
+    }
+    printf("Repetitions: %zu, at least %.0f ms each\n\n",
+           opts.repetitions, opts.min_rep_ns / 1e6);
+    printf("%-32s %10s %9s %9s %9s %9s %12s",
+           "Benchmark", "Iters", "Min", "P50", "P90", "P99", "Ops/s");
+    if (opts.use_perf) {
+        printf(" %9s %9s %9s", "Cyc/op", "Ins/op", "Miss/op");
+    }
+    printf("\n");
+}
+
+bool is_selected(const options& opts, const char* name)
+{
+    if (opts.filters.empty()) {
+        return true;
+    }
+    for (const auto& filter : opts.filters) {
+        if (strstr(name, filter.c_str())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void run_benchmark(const options& opts, const char* name,
+                   const bench::body_t& body)
+{
+    // Warm up caches, branch predictors, and lazily initialized state,
+    // while growing the iteration count until one repetition takes at
+    // least opts.min_rep_ns
+    size_t iterations = 1;
+    uint64_t warm_up_total = 0;
+    for (;;) {
+        uint64_t elapsed = time_body(body, iterations);
+        warm_up_total += elapsed;
+        if (elapsed >= opts.min_rep_ns) {
+            if (warm_up_total >= opts.warm_up_ns) {
+                break;
+            }
+            continue;
+        }
+        double factor = elapsed == 0
+                      ? 10.0
+                      : 1.2 * opts.min_rep_ns / elapsed;
+        factor = std::max(2.0, std::min(10.0, factor));
+        iterations = static_cast<size_t>(iterations * factor);
+    }
+
+#if NVWA_BENCH_HAS_PERF
+    perf_counters counters;
+    bool perf_ok = false;
+    uint64_t perf_values[perf_counter_cnt] = {};
+    if (opts.use_perf && counters.is_open()) {
+        counters.start();
+    }
+#endif
+
+    std::vector<double> ns_per_op;
+    ns_per_op.reserve(opts.repetitions);
+    for (size_t i = 0; i < opts.repetitions; ++i) {
+        ns_per_op.push_back(
+            static_cast<double>(time_body(body, iterations)) / iterations);
+    }
+
+#if NVWA_BENCH_HAS_PERF
+    if (opts.use_perf && counters.is_open()) {
+        perf_ok = counters.stop(perf_values);
+    }
+#endif
+
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    double median = percentile(ns_per_op, 0.5);
+    printf("%-32s %10zu %9.2f %9.2f %9.2f %9.2f %12.4g",
+           name, iterations, ns_per_op.front(), median,
+           percentile(ns_per_op, 0.9), percentile(ns_per_op, 0.99),
+           median == 0 ? 0.0 : 1e9 / median);
+    if (opts.use_perf) {
+#if NVWA_BENCH_HAS_PERF
+        if (perf_ok) {
+            double total_ops =
+                static_cast<double>(iterations) * opts.repetitions;
+            for (size_t i = 0; i < perf_counter_cnt; ++i) {
+                printf(" %9.2f", perf_values[i] / total_ops);
+            }
+        } else
+#endif
+        {
+            printf(" %9s %9s %9s", "-", "-", "-");
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+void usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [--perf] [--reps N] [--min-time MS] [FILTER...]\n"
+            "\n"
+            "  --perf          report hardware counters per operation\n"
+            "  --reps N        number of measured repetitions\n"
+            "  --min-time MS   minimum duration of one repetition\n"
+            "  FILTER          run only benchmarks whose names contain\n"
+            "                  one of the given strings\n",
+            program);
+}
+
+} // unnamed namespace
+
+bool bench::register_benchmark(const char* name, body_t body)
+{
+    get_registry().emplace_back(name, std::move(body));
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    options opts;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            opts.use_perf = true;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            opts.repetitions = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            opts.min_rep_ns = strtoull(argv[++i], nullptr, 10) * 1000000;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            opts.filters.emplace_back(argv[i]);
+        }
+    }
+    if (opts.repetitions == 0 || opts.min_rep_ns == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+#if NVWA_BENCH_HAS_PERF
+    if (opts.use_perf && !perf_counters().is_open()) {
+        fprintf(stderr, "Hardware counters are not available "
+                        "(check /proc/sys/kernel/perf_event_paranoid)\n");
+    }
+#else
+    if (opts.use_perf) {
+        fprintf(stderr, "Hardware counters are not supported here\n");
+    }
+#endif
+
+    auto& registry = get_registry();
+    std::sort(registry.begin(), registry.end(),
+              [](const auto& lhs, const auto& rhs) {
+                  return strcmp(lhs.first, rhs.first) < 0;
+              });
+    print_header(opts);
+    for (const auto& entry : registry) {
+        if (is_selected(opts, entry.first)) {
+            run_benchmark(opts, entry.first, entry.second);
+        }
+    }
+
+    // Release the registry now, as the leak check of debug_new runs
+    // before static objects are destroyed
+    std::vector<std::pair<const char*, bench::body_t>>().swap(registry);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "nvwa/bool_array.h"
+#include <stddef.h>
+#include <stdint.h>
+#include "bench.h"
+
+namespace {
+
+const size_t bit_cnt = 1 << 20;
+
+// Cheap pseudo-random positions, so that the cost of generating them
+// does not dominate
+struct xorshift32 {
+    uint32_t state = 2463534242U;
+    uint32_t operator()()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+nvwa::bool_array& get_bool_array()
+{
+    static nvwa::bool_array ba(bit_cnt);
+    static bool initialized = false;
+    if (!initialized) {
+        ba.initialize(false);
+        initialized = true;
+    }
+    return ba;
+}
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(bool_array_set_random)
+{
+    auto& ba = get_bool_array();
+    xorshift32 rng;
+    for (size_t i = 0; i < iterations; ++i) {
+        ba.set(rng() % bit_cnt);
+    }
+}
+
+NVWA_BENCHMARK(bool_array_test_random)
+{
+    auto& ba = get_bool_array();
+    xorshift32 rng;
+    size_t found = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        found += ba.at(rng() % bit_cnt);
+    }
+    bench::do_not_optimize(found);
+}
+
+// An operation is counting all the bits in a 1-Mibit array
+NVWA_BENCHMARK(bool_array_count_1m)
+{
+    auto& ba = get_bool_array();
+    for (size_t i = 0; i < iterations; ++i) {
+        bench::do_not_optimize(ba.count());
+    }
+}
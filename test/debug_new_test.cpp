@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "nvwa/debug_new.h"
+#include "new_test_util.h"
+
+#ifdef __linux__
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace boost::unit_test_framework;
+
+namespace {
+
+const nvwa::alloc_record* find_record(const nvwa::alloc_snapshot& snapshot,
+                                      const void* usr_ptr)
+{
+    for (const auto& record : snapshot) {
+        if (record.usr_ptr == usr_ptr) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef __linux__
+// Runs a function in a child process with guard pages for every
+// allocation of 32 bytes, and returns its wait status
+int run_guarded(void (*func)(char* ptr))
+{
+    fflush(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        // The test framework would catch the fault otherwise
+        signal(SIGSEGV, SIG_DFL);
+        nvwa::new_guard_page_interval = 1;
+        nvwa::new_guard_page_min_size = 32;
+        nvwa::new_guard_page_max_size = 32;
+        func(new char[32]);
+        _exit(0);
+    }
+    int status = -1;
+    if (pid > 0) {
+        waitpid(pid, &status, 0);
+    }
+    return status;
+}
+
+bool is_killed_by_segv(int status)
+{
+    return status != -1 && WIFSIGNALED(status) &&
+           WTERMSIG(status) == SIGSEGV;
+}
+#endif
+
+} // unnamed namespace
+
+using new_test::disable_autocheck;
+using new_test::output_capture;
+
+BOOST_GLOBAL_FIXTURE(disable_autocheck);
+
+BOOST_AUTO_TEST_CASE(debug_new_shard_test)
+{
+    const int thread_cnt = 4;
+    const int round_cnt = 20;
+    const int block_cnt = 500;
+    static char* blocks[thread_cnt][block_cnt];
+
+    size_t alloc_before = nvwa::get_current_mem_alloc();
+    size_t total_before = nvwa::get_total_mem_alloc_cnt();
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < thread_cnt; ++i) {
+            threads.emplace_back([i] {
+                for (int j = 0; j < round_cnt; ++j) {
+                    for (int k = 0; k < block_cnt; ++k) {
+                        blocks[i][k] = new char[k % 64 + 1];
+                    }
+                    if (j == round_cnt - 1) {
+                        break;          // Freed by the main thread
+                    }
+                    for (int k = 0; k < block_cnt; ++k) {
+                        delete[] blocks[i][k];
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    size_t alloc_in_threads = nvwa::get_current_mem_alloc();
+    size_t total_in_threads = nvwa::get_total_mem_alloc_cnt();
+    for (int i = 0; i < thread_cnt; ++i) {
+        for (int k = 0; k < block_cnt; ++k) {
+            delete[] blocks[i][k];
+        }
+    }
+    size_t alloc_after = nvwa::get_current_mem_alloc();
+
+    size_t block_size_sum = 0;
+    for (int k = 0; k < block_cnt; ++k) {
+        block_size_sum += k % 64 + 1;
+    }
+    BOOST_CHECK_EQUAL(alloc_in_threads - alloc_before,
+                      block_size_sum * thread_cnt);
+    BOOST_CHECK_GE(total_in_threads - total_before,
+                   size_t(thread_cnt) * round_cnt * block_cnt);
+    BOOST_CHECK_EQUAL(alloc_after, alloc_before);
+
+    output_capture capture;
+    BOOST_CHECK_EQUAL(nvwa::check_mem_corruption(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(debug_new_sampling_test)
+{
+    const int block_cnt = 10000;
+    const size_t block_size = 64;
+    const size_t sampling_rate = 4096;
+    static char* blocks[block_cnt];
+
+    size_t saved_sampling_rate = nvwa::new_sampling_rate;
+    size_t alloc_before = nvwa::get_current_mem_alloc();
+    size_t total_before = nvwa::get_total_mem_alloc_cnt();
+    nvwa::new_sampling_rate = sampling_rate;
+    for (int i = 0; i < block_cnt; ++i) {
+        blocks[i] = new char[block_size];
+    }
+    size_t sampled_cnt = nvwa::get_total_mem_alloc_cnt() - total_before;
+    size_t sampled_size = nvwa::get_current_mem_alloc() - alloc_before;
+
+    // Untracked memory can still be freed after sampling is turned off
+    nvwa::new_sampling_rate = saved_sampling_rate;
+    for (int i = 0; i < block_cnt; ++i) {
+        delete[] blocks[i];
+    }
+    size_t alloc_after = nvwa::get_current_mem_alloc();
+
+    // About one allocation is tracked every sampling_rate bytes
+    size_t expected_cnt = block_cnt * block_size / sampling_rate;
+    BOOST_CHECK_GT(sampled_cnt, expected_cnt / 2);
+    BOOST_CHECK_LT(sampled_cnt, expected_cnt * 2);
+    BOOST_CHECK_EQUAL(sampled_size, sampled_cnt * block_size);
+    BOOST_CHECK_EQUAL(alloc_after, alloc_before);
+}
+
+BOOST_AUTO_TEST_CASE(debug_new_stacktrace_test)
+{
+    int* same_site[3];
+    for (int i = 0; i < 3; ++i) {
+        same_site[i] = new int(i);
+    }
+    int* other_site = new int(3);
+
+    nvwa::alloc_snapshot snapshot = nvwa::snapshot_allocations();
+    const nvwa::alloc_record* records[4] = {
+        find_record(snapshot, same_site[0]),
+        find_record(snapshot, same_site[1]),
+        find_record(snapshot, same_site[2]),
+        find_record(snapshot, other_site),
+    };
+    for (const nvwa::alloc_record* record : records) {
+        BOOST_REQUIRE(record != nullptr);
+        BOOST_REQUIRE(record->stacktrace != nullptr);
+    }
+
+    // Identical stack traces are stored once
+    BOOST_CHECK(records[0]->stacktrace == records[1]->stacktrace);
+    BOOST_CHECK(records[0]->stacktrace == records[2]->stacktrace);
+    BOOST_CHECK(records[0]->stacktrace != records[3]->stacktrace);
+
+    // The snapshot keeps the stack traces after the memory is freed
+    for (int i = 0; i < 3; ++i) {
+        delete same_site[i];
+    }
+    delete other_site;
+    BOOST_CHECK(records[0]->stacktrace[0] != nullptr);
+    BOOST_CHECK(records[3]->stacktrace[0] != nullptr);
+
+    // So does a copy of a record, after the snapshot is gone
+    nvwa::alloc_record copy = *records[0];
+    nvwa::alloc_snapshot().swap(snapshot);
+    BOOST_REQUIRE(copy.stacktrace != nullptr);
+    BOOST_CHECK(copy.stacktrace[0] != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(debug_new_aggregated_leak_test)
+{
+    bool saved_aggregate_leaks_flag = nvwa::new_aggregate_leaks_flag;
+    nvwa::new_aggregate_leaks_flag = true;
+    char* leaked[4];
+    for (int i = 0; i < 3; ++i) {
+        leaked[i] = new char[8];
+    }
+    const int line = __LINE__ - 2;
+    leaked[3] = new char[100];
+
+    std::string output;
+    int leak_cnt;
+    {
+        output_capture capture;
+        leak_cnt = nvwa::check_leaks();
+        output = capture.str();
+    }
+    BOOST_CHECK_GE(leak_cnt, 4);
+    std::string site = std::string(" at ") + __FILE__ + ":" +
+                       std::to_string(line) + "\n";
+    auto pos = output.find(site);
+    BOOST_REQUIRE(pos != std::string::npos);
+    auto line_start = output.rfind('\n', pos) + 1;
+    BOOST_CHECK_EQUAL(output.substr(line_start, 26),
+                      "Leaked 3 objects (24 bytes");
+    BOOST_CHECK(output.find("Leaked 1 object (100 bytes, largest 100 at ") !=
+                std::string::npos);
+
+#ifdef _DEBUG
+    // Leaks are still counted when their sites cannot be allocated
+    {
+        output_capture capture;
+        leak_cnt = nvwa::check_leaks();
+        nvwa::new_leak_site_failure_flag = true;
+        int unaggregated_leak_cnt = nvwa::check_leaks();
+        nvwa::new_leak_site_failure_flag = false;
+        output = capture.str();
+        BOOST_CHECK_EQUAL(unaggregated_leak_cnt, leak_cnt);
+    }
+    BOOST_CHECK(output.find(") at (unaggregated)\n") != std::string::npos);
+#endif
+
+    for (char* ptr : leaked) {
+        delete[] ptr;
+    }
+    nvwa::new_aggregate_leaks_flag = saved_aggregate_leaks_flag;
+}
+
+BOOST_AUTO_TEST_CASE(debug_new_snapshot_test)
+{
+    char* freed = new char[10];
+    nvwa::alloc_snapshot before = nvwa::snapshot_allocations();
+    int* added = new int[4];
+    const int line = __LINE__ - 1;
+    delete[] freed;
+    nvwa::alloc_snapshot after = nvwa::snapshot_allocations();
+
+    // Compare the snapshots
+    BOOST_CHECK(find_record(before, freed) != nullptr);
+    BOOST_CHECK(find_record(after, freed) == nullptr);
+    BOOST_CHECK(find_record(before, added) == nullptr);
+    const nvwa::alloc_record* record = find_record(after, added);
+    BOOST_REQUIRE(record != nullptr);
+    BOOST_CHECK_EQUAL(record->size, 4 * sizeof(int));
+    BOOST_CHECK_EQUAL(record->line, line);
+    BOOST_CHECK(record->file != nullptr &&
+                strstr(record->file, "debug_new_test.cpp") != nullptr);
+    BOOST_CHECK(record->addr == nullptr);
+
+    size_t total_size = 0;
+    for (const auto& entry : after) {
+        total_size += entry.size;
+    }
+
+    delete[] added;
+    std::string output;
+    {
+        output_capture capture;
+        nvwa::print_alloc_snapshot(after);
+        output = capture.str();
+    }
+    std::string summary = "*** " + std::to_string(after.size()) +
+                          " objects allocated (" +
+                          std::to_string(total_size) + " bytes)\n";
+    BOOST_CHECK(output.find(summary) != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(debug_new_check_slice_test)
+{
+    const int block_cnt = 1000;
+    const size_t block_size = 24;
+    static char* blocks[block_cnt];
+    for (int i = 0; i < block_cnt; ++i) {
+        blocks[i] = new char[block_size];
+    }
+    char* corrupt = blocks[block_cnt / 2];
+    blocks[block_cnt / 2] = nullptr;
+    corrupt[block_size] = 0;
+
+    // Free blocks between slices, so that the blocks under the check
+    // cursors are freed too; the overwrite must still be found
+    const int max_slice_cnt = 10000;
+    int corrupt_cnt = 0;
+    int next_to_free = 0;
+    std::string output;
+    {
+        output_capture capture;
+        for (int i = 0; i < max_slice_cnt && corrupt_cnt == 0; ++i) {
+            corrupt_cnt = nvwa::check_mem_corruption_slice(7);
+            for (int j = 0; j < 5 && next_to_free < block_cnt; ++j) {
+                delete[] blocks[next_to_free++];
+            }
+        }
+        output = capture.str();
+    }
+    corrupt[block_size] = static_cast<char>(0xCC);
+    while (next_to_free < block_cnt) {
+        delete[] blocks[next_to_free++];
+    }
+    delete[] corrupt;
+
+    BOOST_CHECK_EQUAL(corrupt_cnt, 1);
+    char expected[64];
+    snprintf(expected, sizeof expected,
+             "Overwritten past end of object at %p", corrupt);
+    BOOST_CHECK(output.find(expected) != std::string::npos);
+    output_capture capture;
+    BOOST_CHECK_EQUAL(nvwa::check_mem_corruption(), 0);
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(debug_new_guard_page_test)
+{
+    // An overrun faults at the offending write
+    int status = run_guarded([](char* ptr) {
+        static_cast<volatile char*>(ptr)[32] = 0;
+    });
+    BOOST_CHECK(is_killed_by_segv(status));
+
+    // So does an access after the memory is freed, in quarantine
+    status = run_guarded([](char* ptr) {
+        delete[] ptr;
+        static_cast<volatile char*>(ptr)[0] = 0;
+    });
+    BOOST_CHECK(is_killed_by_segv(status));
+
+    // Memory is still allocated when guard pages cannot be mapped
+    status = run_guarded([](char* ptr) {
+        delete[] ptr;
+        long page_cnt = 0;
+        if (FILE* fp = fopen("/proc/self/statm", "r")) {
+            if (fscanf(fp, "%ld", &page_cnt) != 1) {
+                page_cnt = 0;
+            }
+            fclose(fp);
+        }
+        if (page_cnt == 0) {
+            _exit(2);
+        }
+        rlimit limit;
+        getrlimit(RLIMIT_AS, &limit);
+        limit.rlim_cur = static_cast<rlim_t>(page_cnt) *
+                         static_cast<rlim_t>(sysconf(_SC_PAGESIZE));
+        if (setrlimit(RLIMIT_AS, &limit) != 0) {
+            _exit(2);
+        }
+        ptr = new char[32];
+        ptr[31] = 0;
+        delete[] ptr;
+    });
+    BOOST_CHECK(status != -1 && WIFEXITED(status) &&
+                WEXITSTATUS(status) == 0);
+}
+#endif
@@ -0,0 +1,97 @@
+#include "nvwa/fast_shared_mutex.h"
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "nvwa/class_level_lock.h"
+#include "nvwa/object_level_lock.h"
+
+using namespace boost::unit_test_framework;
+
+namespace {
+
+class shared_table
+    : public nvwa::object_level_lock<shared_table, nvwa::fast_shared_mutex> {
+public:
+    int values[2] = {0, 0};
+};
+
+class shared_counter
+    : public nvwa::class_level_lock<shared_counter, true,
+                                    std::shared_mutex> {
+public:
+    static int value;
+};
+
+int shared_counter::value = 0;
+
+} // unnamed namespace
+
+BOOST_AUTO_TEST_CASE(fast_shared_mutex_exclusion_test)
+{
+    nvwa::fast_shared_mutex mtx;
+    mtx.lock_shared();
+    BOOST_CHECK(!mtx.try_lock());
+    std::thread reader([&mtx] {
+        BOOST_CHECK(mtx.try_lock_shared());
+        mtx.unlock_shared();
+    });
+    reader.join();
+    mtx.unlock_shared();
+
+    BOOST_CHECK(mtx.try_lock());
+    std::thread blocked_reader([&mtx] {
+        BOOST_CHECK(!mtx.try_lock_shared());
+    });
+    blocked_reader.join();
+    mtx.unlock();
+    BOOST_CHECK(mtx.try_lock_shared());
+    mtx.unlock_shared();
+}
+
+BOOST_AUTO_TEST_CASE(object_level_shared_lock_test)
+{
+    const int thread_cnt = 4;
+    const int loop_cnt = 20000;
+    shared_table table;
+    std::atomic<int> mismatch_cnt{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_cnt; ++i) {
+        threads.emplace_back([&table, &mismatch_cnt, i] {
+            for (int j = 0; j < loop_cnt; ++j) {
+                if (i == 0 && j % 16 == 0) {
+                    shared_table::lock guard(table);
+                    ++table.values[0];
+                    ++table.values[1];
+                } else {
+                    shared_table::shared_lock guard(table);
+                    if (table.values[0] != table.values[1]) {
+                        ++mismatch_cnt;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(mismatch_cnt.load(), 0);
+    BOOST_CHECK_EQUAL(table.values[0], (loop_cnt + 15) / 16);
+}
+
+BOOST_AUTO_TEST_CASE(class_level_shared_lock_test)
+{
+    {
+        shared_counter::lock guard;
+        ++shared_counter::value;
+    }
+    {
+        shared_counter::shared_lock guard1;
+        std::thread reader([] {
+            shared_counter::shared_lock guard2;
+            BOOST_CHECK_EQUAL(shared_counter::value, 1);
+        });
+        reader.join();
+    }
+}
@@ -0,0 +1,62 @@
+#include "nvwa/fc_queue.h"
+#include <stddef.h>
+#include <algorithm>
+#include <thread>
+#include "bench.h"
+
+namespace {
+
+const size_t queue_size = 1024;
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(fc_queue_push_pop)
+{
+    static nvwa::fc_queue<int> q(queue_size);
+    for (size_t i = 0; i < iterations; ++i) {
+        q.push(static_cast<int>(i));
+        bench::do_not_optimize(q.front());
+        q.pop();
+    }
+}
+
+NVWA_BENCHMARK(fc_queue_fill_drain)
+{
+    static nvwa::fc_queue<int> q(queue_size);
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = std::min(queue_size, iterations - done);
+        for (size_t i = 0; i < batch; ++i) {
+            q.push(static_cast<int>(i));
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            bench::do_not_optimize(q.front());
+            q.pop();
+        }
+        done += batch;
+    }
+}
+
+// Producer and consumer on separate threads; an operation is one
+// element passed through the queue
+NVWA_BENCHMARK(fc_queue_spsc_threads)
+{
+    nvwa::fc_queue<size_t> q(queue_size);
+    std::thread producer([&q, iterations] {
+        for (size_t i = 0; i < iterations; ++i) {
+            while (!q.write(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    size_t sum = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        size_t value;
+        while (!q.read(value)) {
+            std::this_thread::yield();
+        }
+        sum += value;
+    }
+    producer.join();
+    bench::do_not_optimize(sum);
+}
@@ -17,6 +17,14 @@ private:
     DECLARE_FIXED_MEM_POOL(Obj)
 };
 
+class GrowableObj {
+public:
+    GrowableObj() {}
+private:
+    char a[20];
+    DECLARE_FIXED_MEM_POOL(GrowableObj)
+};
+
 #ifdef __clang__
 #pragma GCC diagnostic pop
 #endif
@@ -39,3 +47,27 @@ BOOST_AUTO_TEST_CASE(fixed_mem_test)
     delete p4;
     BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<Obj>::deinitialize(), 0);
 }
+
+template <>
+struct nvwa::fixed_mem_pool<GrowableObj>::growable {
+    static const bool value = true;
+};
+
+BOOST_AUTO_TEST_CASE(fixed_mem_growable_test)
+{
+    BOOST_REQUIRE(nvwa::fixed_mem_pool<GrowableObj>::initialize(2));
+    BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<GrowableObj>::get_capacity(), 2U);
+    GrowableObj* objs[10];
+    for (int i = 0; i < 10; ++i) {
+        objs[i] = new GrowableObj();
+    }
+    // Segments of 2, 2, 4, and 8 blocks
+    BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<GrowableObj>::get_capacity(),
+                      16U);
+    BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<GrowableObj>::deinitialize(), 10);
+    for (int i = 0; i < 10; ++i) {
+        delete objs[i];
+    }
+    BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<GrowableObj>::deinitialize(), 0);
+    BOOST_CHECK(!nvwa::fixed_mem_pool<GrowableObj>::is_initialized());
+}
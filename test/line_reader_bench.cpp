@@ -0,0 +1,106 @@
+#include "nvwa/file_line_reader.h"
+#include "nvwa/istream_line_reader.h"
+#include "nvwa/mmap_line_reader.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <fstream>
+#include <string>
+#include "bench.h"
+
+namespace {
+
+const char* const path = "line_reader_bench.tmp";
+const size_t line_cnt = 100000;
+
+// Creates the input file on first use, and removes it at exit
+class input_file {
+public:
+    input_file()
+    {
+        std::ofstream ofs(path);
+        for (size_t i = 0; i < line_cnt; ++i) {
+            ofs << "Line " << i
+                << ": the quick brown fox jumps over the lazy dog\n";
+        }
+    }
+    ~input_file()
+    {
+        remove(path);
+    }
+};
+
+const char* get_input_path()
+{
+    static input_file file;
+    return path;
+}
+
+// Reads iterations lines with a reader type, reopening the file when
+// it is exhausted; an operation is reading one line
+template <typename _Open>
+void read_lines(size_t iterations, _Open open_and_read)
+{
+    const char* input_path = get_input_path();
+    size_t done = 0;
+    while (done < iterations) {
+        done += open_and_read(input_path, iterations - done);
+    }
+}
+
+template <typename _Iter>
+size_t get_line_size(const _Iter& it)
+{
+    return it->size();
+}
+
+size_t get_line_size(const nvwa::file_line_reader::iterator& it)
+{
+    return it.size();
+}
+
+template <typename _Reader>
+size_t consume(_Reader& reader, size_t max_lines)
+{
+    size_t lines = 0;
+    size_t total = 0;
+    for (auto it = reader.begin(), end = reader.end();
+         it != end && lines < max_lines; ++it) {
+        total += get_line_size(it);
+        ++lines;
+    }
+    bench::do_not_optimize(total);
+    return lines;
+}
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(line_reader_istream)
+{
+    read_lines(iterations, [](const char* input_path, size_t max_lines) {
+        std::ifstream ifs(input_path);
+        nvwa::istream_line_reader reader(ifs);
+        return consume(reader, max_lines);
+    });
+}
+
+NVWA_BENCHMARK(line_reader_file)
+{
+    read_lines(iterations, [](const char* input_path, size_t max_lines) {
+        FILE* fp = fopen(input_path, "r");
+        size_t lines;
+        {
+            nvwa::file_line_reader reader(fp);
+            lines = consume(reader, max_lines);
+        }
+        fclose(fp);
+        return lines;
+    });
+}
+
+NVWA_BENCHMARK(line_reader_mmap)
+{
+    read_lines(iterations, [](const char* input_path, size_t max_lines) {
+        nvwa::mmap_line_reader reader(input_path);
+        return consume(reader, max_lines);
+    });
+}
@@ -0,0 +1,126 @@
+#include "nvwa/mem_arena.h"
+#include "nvwa/mem_pool_resource.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <memory_resource>
+#include <vector>
+#include "bench.h"
+
+namespace {
+
+const size_t block_size = 48;
+const size_t batch_size = 256;
+
+// Allocates batch_size blocks, and then frees them; an operation is one
+// allocation plus one deallocation
+void resource_batches(size_t iterations, std::pmr::memory_resource* res)
+{
+    void* blocks[batch_size];
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = iterations - done < batch_size
+                     ? iterations - done
+                     : batch_size;
+        for (size_t i = 0; i < batch; ++i) {
+            blocks[i] = res->allocate(block_size);
+            bench::do_not_optimize(blocks[i]);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            res->deallocate(blocks[i], block_size);
+        }
+        done += batch;
+    }
+}
+
+// An operation is growing a vector to 64 elements and destroying it
+void vector_growth(size_t iterations, std::pmr::memory_resource* res)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        std::pmr::vector<int> v(res);
+        for (int j = 0; j < 64; ++j) {
+            v.push_back(j);
+        }
+        bench::do_not_optimize(v.data());
+    }
+}
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(mem_arena_malloc_free_48)
+{
+    void* blocks[batch_size];
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = iterations - done < batch_size
+                     ? iterations - done
+                     : batch_size;
+        for (size_t i = 0; i < batch; ++i) {
+            blocks[i] = malloc(block_size);
+            bench::do_not_optimize(blocks[i]);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            free(blocks[i]);
+        }
+        done += batch;
+    }
+}
+
+// An operation is one allocation; the arena is reset after each batch
+NVWA_BENCHMARK(mem_arena_allocate_48)
+{
+    nvwa::mem_arena arena(block_size * batch_size * 2);
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = iterations - done < batch_size
+                     ? iterations - done
+                     : batch_size;
+        for (size_t i = 0; i < batch; ++i) {
+            bench::do_not_optimize(arena.allocate(block_size));
+        }
+        arena.reset();
+        done += batch;
+    }
+}
+
+NVWA_BENCHMARK(mem_arena_resource_vector)
+{
+    nvwa::mem_arena arena(8192);
+    nvwa::mem_arena_resource res(arena);
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = iterations - done < batch_size
+                     ? iterations - done
+                     : batch_size;
+        vector_growth(batch, &res);
+        arena.reset();
+        done += batch;
+    }
+}
+
+NVWA_BENCHMARK(pmr_new_delete_48)
+{
+    resource_batches(iterations, std::pmr::new_delete_resource());
+}
+
+NVWA_BENCHMARK(pmr_unsync_pool_48)
+{
+    std::pmr::unsynchronized_pool_resource res;
+    resource_batches(iterations, &res);
+}
+
+NVWA_BENCHMARK(pmr_static_mem_pool_48)
+{
+    nvwa::static_mem_pool_resource res;
+    resource_batches(iterations, &res);
+}
+
+NVWA_BENCHMARK(pmr_new_delete_vector)
+{
+    vector_growth(iterations, std::pmr::new_delete_resource());
+}
+
+NVWA_BENCHMARK(pmr_static_mem_pool_vector)
+{
+    nvwa::static_mem_pool_resource res;
+    vector_growth(iterations, &res);
+}
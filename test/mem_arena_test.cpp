@@ -0,0 +1,88 @@
+#include "nvwa/mem_arena.h"
+#include <map>
+#include <new>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <boost/test/unit_test.hpp>
+
+#if HAVE_CXX17_MEMORY_RESOURCE
+#include <memory_resource>
+#endif
+
+using namespace boost::unit_test_framework;
+
+BOOST_AUTO_TEST_CASE(mem_arena_test)
+{
+    nvwa::mem_arena arena(256);
+    void* ptr1 = arena.allocate(10);
+    void* ptr2 = arena.allocate(10);
+    BOOST_REQUIRE(ptr1 != nullptr && ptr2 != nullptr);
+    BOOST_CHECK(ptr1 != ptr2);
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr2) %
+                          alignof(max_align_t), 0U);
+    void* ptr3 = arena.allocate(1, 128);
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr3) % 128, 0U);
+
+    {
+        nvwa::mem_arena::scope outer(arena);
+        void* ptr4 = arena.allocate(8);
+        {
+            nvwa::mem_arena::scope inner(arena);
+            void* ptr5 = arena.allocate(8, 8);
+            BOOST_CHECK(ptr5 != ptr4);
+        }
+        BOOST_CHECK_EQUAL(arena.allocate(8, 8),
+                          static_cast<void*>(static_cast<char*>(ptr4) + 8));
+    }
+
+    // Chain more blocks, including one bigger than the block size
+    void* big = arena.allocate(1000);
+    BOOST_REQUIRE(big != nullptr);
+    memset(big, 0, 1000);
+    for (int i = 0; i < 100; ++i) {
+        BOOST_REQUIRE(arena.allocate(32) != nullptr);
+    }
+
+    arena.reset();
+    BOOST_CHECK_EQUAL(arena.allocate(10), ptr1);
+    arena.release();
+    BOOST_CHECK_EQUAL(arena.allocate(10), ptr1);
+}
+
+BOOST_AUTO_TEST_CASE(mem_arena_buffer_test)
+{
+    alignas(max_align_t) char buffer[128];
+    nvwa::mem_arena arena(buffer, sizeof buffer);
+    void* ptr = arena.allocate(64);
+    BOOST_REQUIRE(ptr != nullptr);
+    BOOST_CHECK(static_cast<char*>(ptr) >= buffer &&
+                static_cast<char*>(ptr) < buffer + sizeof buffer);
+    BOOST_CHECK(arena.allocate(64) == nullptr);
+    arena.reset();
+    BOOST_CHECK_EQUAL(arena.allocate(64), ptr);
+}
+
+BOOST_AUTO_TEST_CASE(mem_arena_allocator_test)
+{
+    nvwa::mem_arena arena;
+    {
+        nvwa::mem_arena_allocator<int> alloc(arena);
+        std::vector<int, nvwa::mem_arena_allocator<int>> v(alloc);
+        for (int i = 0; i < 1000; ++i) {
+            v.push_back(i);
+        }
+        BOOST_CHECK_EQUAL(v[999], 999);
+    }
+#if HAVE_CXX17_MEMORY_RESOURCE
+    {
+        nvwa::mem_arena_resource resource(arena);
+        std::pmr::map<int, int> m(&resource);
+        for (int i = 0; i < 1000; ++i) {
+            m[i] = i * 2;
+        }
+        BOOST_CHECK_EQUAL(m[500], 1000);
+    }
+#endif
+}
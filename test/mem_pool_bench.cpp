@@ -0,0 +1,69 @@
+#include "nvwa/fixed_mem_pool.h"
+#include "nvwa/static_mem_pool.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include "bench.h"
+
+namespace {
+
+const size_t block_size = 64;
+const size_t batch_size = 256;
+
+class pooled_obj {
+public:
+    pooled_obj() {}
+    char data[block_size];
+    DECLARE_FIXED_MEM_POOL(pooled_obj)
+};
+
+typedef nvwa::static_mem_pool<block_size> static_pool_type;
+
+// Allocates batch_size blocks, and then frees them; an operation is one
+// allocation plus one deallocation.  The allocator functions shall be
+// inline-friendly, so they are passed as template arguments.
+template <typename _Alloc, typename _Dealloc>
+void alloc_free_batches(size_t iterations, _Alloc alloc, _Dealloc dealloc)
+{
+    void* blocks[batch_size];
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = iterations - done < batch_size
+                     ? iterations - done
+                     : batch_size;
+        for (size_t i = 0; i < batch; ++i) {
+            blocks[i] = alloc();
+            bench::do_not_optimize(blocks[i]);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            dealloc(blocks[i]);
+        }
+        done += batch;
+    }
+}
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(mem_pool_malloc_free_64)
+{
+    alloc_free_batches(
+        iterations, [] { return malloc(block_size); },
+        [](void* ptr) { free(ptr); });
+}
+
+NVWA_BENCHMARK(mem_pool_static_64)
+{
+    auto& pool = static_pool_type::instance();
+    alloc_free_batches(
+        iterations, [&pool] { return pool.allocate(); },
+        [&pool](void* ptr) { pool.deallocate(ptr); });
+}
+
+NVWA_BENCHMARK(mem_pool_fixed_64)
+{
+    if (!nvwa::fixed_mem_pool<pooled_obj>::is_initialized()) {
+        nvwa::fixed_mem_pool<pooled_obj>::initialize(batch_size);
+    }
+    alloc_free_batches(
+        iterations, [] { return static_cast<void*>(new pooled_obj); },
+        [](void* ptr) { delete static_cast<pooled_obj*>(ptr); });
+}
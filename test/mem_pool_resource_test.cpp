@@ -0,0 +1,85 @@
+#include "nvwa/mem_pool_resource.h"
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <boost/test/unit_test.hpp>
+
+using namespace boost::unit_test_framework;
+
+namespace {
+
+class counting_resource : public std::pmr::memory_resource {
+public:
+    size_t alloc_cnt = 0;
+    size_t dealloc_cnt = 0;
+
+private:
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        ++alloc_cnt;
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+    void do_deallocate(void* ptr, size_t size, size_t alignment) override
+    {
+        ++dealloc_cnt;
+        std::pmr::new_delete_resource()->deallocate(ptr, size, alignment);
+    }
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+struct Node {
+    char data[40];
+};
+
+} /* unnamed namespace */
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_resource_test)
+{
+    counting_resource upstream;
+    nvwa::static_mem_pool_resource resource(&upstream);
+    {
+        std::pmr::map<int, int> m(&resource);
+        for (int i = 0; i < 1000; ++i) {
+            m[i] = i;
+        }
+        BOOST_CHECK_EQUAL(m[999], 999);
+    }
+    BOOST_CHECK_EQUAL(upstream.alloc_cnt, 0U);
+
+    void* ptr = resource.allocate(24, 8);
+    resource.deallocate(ptr, 24, 8);
+    ptr = resource.allocate(1000);
+    BOOST_CHECK_EQUAL(upstream.alloc_cnt, 1U);
+    resource.deallocate(ptr, 1000);
+    ptr = resource.allocate(48, 64);
+    BOOST_CHECK_EQUAL(upstream.alloc_cnt, 2U);
+    resource.deallocate(ptr, 48, 64);
+    BOOST_CHECK_EQUAL(upstream.dealloc_cnt, 2U);
+
+    nvwa::static_mem_pool_resource resource2(&upstream);
+    BOOST_CHECK(resource == resource2);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_mem_pool_resource_test)
+{
+    counting_resource upstream;
+    BOOST_REQUIRE(nvwa::fixed_mem_pool<Node>::initialize(4));
+    {
+        nvwa::fixed_mem_pool_resource<Node> resource(&upstream);
+        void* ptr1 = resource.allocate(sizeof(Node), alignof(Node));
+        void* ptr2 = resource.allocate(16, 8);
+        BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<Node>::get_alloc_count(), 2);
+        void* ptr3 = resource.allocate(100);
+        BOOST_CHECK_EQUAL(upstream.alloc_cnt, 1U);
+        resource.deallocate(ptr3, 100);
+        resource.deallocate(ptr2, 16, 8);
+        resource.deallocate(ptr1, sizeof(Node), alignof(Node));
+    }
+    BOOST_CHECK_EQUAL(nvwa::fixed_mem_pool<Node>::deinitialize(), 0);
+}
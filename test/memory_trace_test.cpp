@@ -0,0 +1,233 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "nvwa/memory_trace.h"
+#include "new_test_util.h"
+
+using namespace boost::unit_test_framework;
+
+namespace {
+
+const nvwa::context_stats* find_stats(const nvwa::context_stats_list& stats,
+                                      uint32_t ctx_id)
+{
+    for (const auto& entry : stats) {
+        if (entry.ctx_id == ctx_id) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const nvwa::alloc_record* find_record(const nvwa::alloc_snapshot& snapshot,
+                                      const void* usr_ptr)
+{
+    for (const auto& record : snapshot) {
+        if (record.usr_ptr == usr_ptr) {
+            return &record;
+        }
+    }
+    return nullptr;
+}
+
+} // unnamed namespace
+
+using new_test::disable_autocheck;
+using new_test::output_capture;
+
+BOOST_GLOBAL_FIXTURE(disable_autocheck);
+
+BOOST_AUTO_TEST_CASE(memory_trace_snapshot_test)
+{
+    const nvwa::context ctx{__FILE__, "snapshot_test"};
+    char* freed = new char[10];
+    nvwa::alloc_snapshot before = nvwa::snapshot_allocations();
+    int* added = new (ctx) int[4];
+    delete[] freed;
+    nvwa::alloc_snapshot after = nvwa::snapshot_allocations();
+
+    // Compare the snapshots
+    BOOST_CHECK(find_record(before, freed) != nullptr);
+    BOOST_CHECK(find_record(after, freed) == nullptr);
+    BOOST_CHECK(find_record(before, added) == nullptr);
+    const nvwa::alloc_record* record = find_record(after, added);
+    BOOST_REQUIRE(record != nullptr);
+    BOOST_CHECK_EQUAL(record->size, 4 * sizeof(int));
+    BOOST_CHECK_EQUAL(record->ctx_id, nvwa::intern_context(ctx));
+    BOOST_CHECK(record->ctx == ctx);
+    delete[] added;
+}
+
+BOOST_AUTO_TEST_CASE(memory_trace_context_stats_test)
+{
+    const nvwa::context outer_ctx{__FILE__, "stats_outer"};
+    const nvwa::context inner_ctx{__FILE__, "stats_inner"};
+    nvwa::context_stats_list baseline = nvwa::get_context_stats();
+    char* outer_ptrs[2];
+    char* inner_ptrs[3];
+    {
+        nvwa::checkpoint outer(outer_ctx);
+        outer_ptrs[0] = new char[100];
+        {
+            nvwa::checkpoint inner(inner_ctx);
+            for (char*& ptr : inner_ptrs) {
+                ptr = new char[10];
+            }
+        }
+        outer_ptrs[1] = new char[200];
+    }
+    delete[] inner_ptrs[0];
+    nvwa::context_stats_list stats = nvwa::get_context_stats();
+
+    const nvwa::context_stats* outer =
+        find_stats(stats, nvwa::intern_context(outer_ctx));
+    BOOST_REQUIRE(outer != nullptr);
+    BOOST_CHECK(outer->ctx == outer_ctx);
+    BOOST_CHECK_EQUAL(outer->live_bytes, 300U);
+    BOOST_CHECK_EQUAL(outer->live_cnt, 2U);
+    BOOST_CHECK_EQUAL(outer->total_cnt, 2U);
+    BOOST_CHECK_EQUAL(outer->peak_bytes, 300U);
+
+    const nvwa::context_stats* inner =
+        find_stats(stats, nvwa::intern_context(inner_ctx));
+    BOOST_REQUIRE(inner != nullptr);
+    BOOST_CHECK(inner->ctx == inner_ctx);
+    BOOST_CHECK_EQUAL(inner->live_bytes, 20U);
+    BOOST_CHECK_EQUAL(inner->live_cnt, 2U);
+    BOOST_CHECK_EQUAL(inner->total_cnt, 3U);
+    BOOST_CHECK_EQUAL(inner->peak_bytes, 30U);
+
+    std::string output;
+    {
+        output_capture capture;
+        nvwa::print_context_stats(stats, &baseline);
+        output = capture.str();
+    }
+    BOOST_CHECK(output.find("300 bytes in 2 objects (peak 300 bytes, "
+                            "2 allocations; +300 bytes, 2 allocations "
+                            "since baseline) in context: ") !=
+                std::string::npos);
+    BOOST_CHECK(output.find("/stats_inner\n") != std::string::npos);
+
+    for (char* ptr : outer_ptrs) {
+        delete[] ptr;
+    }
+    delete[] inner_ptrs[1];
+    delete[] inner_ptrs[2];
+    stats = nvwa::get_context_stats();
+    outer = find_stats(stats, nvwa::intern_context(outer_ctx));
+    BOOST_REQUIRE(outer != nullptr);
+    BOOST_CHECK_EQUAL(outer->live_bytes, 0U);
+    BOOST_CHECK_EQUAL(outer->peak_bytes, 300U);
+}
+
+BOOST_AUTO_TEST_CASE(memory_trace_intern_context_test)
+{
+    // Equal contexts get the same ID, even with different pointers
+    static char file[] = "intern_file";
+    static char func[] = "intern_func";
+    static char file_copy[] = "intern_file";
+    uint32_t ctx_id = nvwa::intern_context(nvwa::context{file, func});
+    BOOST_CHECK_NE(ctx_id, 0U);
+    BOOST_CHECK_EQUAL(nvwa::intern_context(nvwa::context{file_copy, func}),
+                      ctx_id);
+    BOOST_CHECK(nvwa::get_context(ctx_id) == (nvwa::context{file, func}));
+
+    // The ID table grows as more contexts are interned
+    const int ctx_cnt = 1000;
+    static char funcs[ctx_cnt][16];
+    static uint32_t ctx_ids[ctx_cnt];
+    for (int i = 0; i < ctx_cnt; ++i) {
+        snprintf(funcs[i], sizeof funcs[i], "func_%d", i);
+        ctx_ids[i] = nvwa::intern_context(nvwa::context{file, funcs[i]});
+        BOOST_REQUIRE_NE(ctx_ids[i], 0U);
+        BOOST_REQUIRE_NE(ctx_ids[i], ctx_id);
+        BOOST_REQUIRE(i == 0 || ctx_ids[i] != ctx_ids[i - 1]);
+    }
+    for (int i = 0; i < ctx_cnt; ++i) {
+        BOOST_REQUIRE_EQUAL(
+            nvwa::intern_context(nvwa::context{file, funcs[i]}), ctx_ids[i]);
+        BOOST_REQUIRE(nvwa::get_context(ctx_ids[i]) ==
+                      (nvwa::context{file, funcs[i]}));
+    }
+
+    // Unknown IDs map to the unknown context
+    nvwa::context unknown_ctx = nvwa::get_context(0);
+    BOOST_CHECK_EQUAL(unknown_ctx.func, "<UNKNOWN>");
+    BOOST_CHECK(nvwa::get_context(ctx_ids[ctx_cnt - 1] + 1) == unknown_ctx);
+
+    // A checkpoint assigns its context to the allocations in its scope
+    int* ptr;
+    {
+        NVWA_MEMORY_CHECKPOINT();
+        ptr = new int;
+    }
+    nvwa::alloc_snapshot snapshot = nvwa::snapshot_allocations();
+    const nvwa::alloc_record* record = find_record(snapshot, ptr);
+    BOOST_REQUIRE(record != nullptr);
+    BOOST_CHECK_EQUAL(record->ctx.file, __FILE__);
+    BOOST_CHECK(strstr(record->ctx.func,
+                       "memory_trace_intern_context_test") != nullptr);
+    delete ptr;
+}
+
+BOOST_AUTO_TEST_CASE(memory_trace_profile_test)
+{
+    const nvwa::context ctx{__FILE__, "profile_test"};
+    char* ptrs[4];
+    {
+        nvwa::checkpoint checkpoint(ctx);
+        ptrs[0] = new char[1];
+        ptrs[1] = new char[100];
+        ptrs[2] = new char[127];
+        ptrs[3] = new char[5000];
+    }
+    delete[] ptrs[0];
+    delete[] ptrs[1];
+
+    nvwa::context_profile_list profiles = nvwa::get_context_profiles();
+    uint32_t ctx_id = nvwa::intern_context(ctx);
+    const nvwa::context_profile* profile = nullptr;
+    for (const auto& entry : profiles) {
+        if (entry.ctx_id == ctx_id) {
+            profile = &entry;
+        }
+    }
+    BOOST_REQUIRE(profile != nullptr);
+    BOOST_CHECK(profile->ctx == ctx);
+
+    // Bucket i counts values in [2**(i-1), 2**i)
+    size_t size_cnt = 0;
+    size_t lifetime_cnt = 0;
+    for (size_t i = 0; i < nvwa::context_profile_bucket_cnt; ++i) {
+        size_cnt += profile->size_hist[i];
+        lifetime_cnt += profile->lifetime_hist[i];
+    }
+    BOOST_CHECK_EQUAL(size_cnt, 4U);
+    BOOST_CHECK_EQUAL(profile->size_hist[1], 1U);
+    BOOST_CHECK_EQUAL(profile->size_hist[7], 2U);
+    BOOST_CHECK_EQUAL(profile->size_hist[13], 1U);
+    BOOST_CHECK_EQUAL(lifetime_cnt, 2U);
+
+    std::string output;
+    {
+        output_capture capture;
+        nvwa::print_context_profiles(profiles);
+        output = capture.str();
+    }
+    std::string header =
+        std::string("Profile of context: ") + __FILE__ + "/profile_test\n";
+    auto pos = output.find(header);
+    BOOST_REQUIRE(pos != std::string::npos);
+    std::string size_hist = "  Allocation sizes (bytes):\n"
+                            "    1-1: 1\n"
+                            "    64-127: 2\n"
+                            "    4096-8191: 1\n";
+    BOOST_CHECK_EQUAL(output.substr(pos + header.size(), size_hist.size()),
+                      size_hist);
+
+    delete[] ptrs[2];
+    delete[] ptrs[3];
+}
@@ -0,0 +1,125 @@
+#include "nvwa/fast_mutex.h"
+#include "nvwa/fast_shared_mutex.h"
+#include "nvwa/object_level_lock.h"
+#include "nvwa/spin_mutex.h"
+#include <stddef.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+// The benchmarks in this file are also built into separate programs
+// with the futex-based and the profiling fast_mutex, as the choice is
+// made at compile time and must be the same in the whole program.
+
+namespace {
+
+const size_t thread_cnt = 4;
+
+// Object protected by striped_object_level_lock
+class striped_counter
+    : public nvwa::striped_object_level_lock<striped_counter> {
+public:
+    size_t value = 0;
+};
+
+// An operation is one lock plus one unlock in one thread
+template <typename _Mutex>
+void lock_unlock(size_t iterations)
+{
+    static _Mutex mtx;
+    size_t count = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        std::lock_guard<_Mutex> guard(mtx);
+        ++count;
+    }
+    bench::do_not_optimize(count);
+}
+
+// An operation is one lock plus one unlock, evenly split among
+// thread_cnt threads incrementing a shared counter
+template <typename _Mutex>
+void lock_unlock_contended(size_t iterations)
+{
+    static _Mutex mtx;
+    size_t count = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_cnt; ++i) {
+        size_t share = iterations / thread_cnt +
+                       (i < iterations % thread_cnt ? 1 : 0);
+        threads.emplace_back([&count, share] {
+            for (size_t j = 0; j < share; ++j) {
+                std::lock_guard<_Mutex> guard(mtx);
+                ++count;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    bench::do_not_optimize(count);
+}
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(mutex_std_mutex)
+{
+    lock_unlock<std::mutex>(iterations);
+}
+
+NVWA_BENCHMARK(mutex_fast_mutex)
+{
+    lock_unlock<nvwa::fast_mutex>(iterations);
+}
+
+NVWA_BENCHMARK(mutex_spin_mutex)
+{
+    lock_unlock<nvwa::spin_mutex>(iterations);
+}
+
+NVWA_BENCHMARK(mutex_fast_shared_mutex)
+{
+    lock_unlock<nvwa::fast_shared_mutex>(iterations);
+}
+
+// An operation is one lock_shared plus one unlock_shared
+NVWA_BENCHMARK(mutex_fast_shared_mutex_shared)
+{
+    static nvwa::fast_shared_mutex mtx;
+    for (size_t i = 0; i < iterations; ++i) {
+        mtx.lock_shared();
+        mtx.unlock_shared();
+    }
+}
+
+// An operation is one lock plus one unlock of an object, including the
+// lookup of its stripe
+NVWA_BENCHMARK(mutex_striped_object_lock)
+{
+    static striped_counter counter;
+    for (size_t i = 0; i < iterations; ++i) {
+        striped_counter::lock guard(counter);
+        ++counter.value;
+    }
+    bench::do_not_optimize(counter.value);
+}
+
+NVWA_BENCHMARK(mutex_std_mutex_contended)
+{
+    lock_unlock_contended<std::mutex>(iterations);
+}
+
+NVWA_BENCHMARK(mutex_fast_mutex_contended)
+{
+    lock_unlock_contended<nvwa::fast_mutex>(iterations);
+}
+
+NVWA_BENCHMARK(mutex_spin_mutex_contended)
+{
+    lock_unlock_contended<nvwa::spin_mutex>(iterations);
+}
+
+NVWA_BENCHMARK(mutex_fast_shared_mutex_contended)
+{
+    lock_unlock_contended<nvwa::fast_shared_mutex>(iterations);
+}
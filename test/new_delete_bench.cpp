@@ -0,0 +1,67 @@
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "bench.h"
+
+// The benchmarks in this file are also linked with debug_new.cpp into
+// a separate program, so that the overhead of debug_new can be seen by
+// comparing the results of the two programs.
+
+namespace {
+
+const size_t batch_size = 256;
+
+template <size_t _Sz>
+struct object {
+    char data[_Sz];
+};
+
+// An operation is one new plus one delete
+template <size_t _Sz>
+void new_delete_batches(size_t iterations)
+{
+    object<_Sz>* objects[batch_size];
+    size_t done = 0;
+    while (done < iterations) {
+        size_t batch = iterations - done < batch_size
+                     ? iterations - done
+                     : batch_size;
+        for (size_t i = 0; i < batch; ++i) {
+            objects[i] = new object<_Sz>;
+            bench::do_not_optimize(objects[i]);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            delete objects[i];
+        }
+        done += batch;
+    }
+}
+
+} // unnamed namespace
+
+NVWA_BENCHMARK(new_delete_16)
+{
+    new_delete_batches<16>(iterations);
+}
+
+NVWA_BENCHMARK(new_delete_256)
+{
+    new_delete_batches<256>(iterations);
+}
+
+NVWA_BENCHMARK(new_delete_4096)
+{
+    new_delete_batches<4096>(iterations);
+}
+
+// An operation is growing a vector of strings to 64 elements
+NVWA_BENCHMARK(new_delete_vector_strings)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        std::vector<std::string> v;
+        for (int j = 0; j < 64; ++j) {
+            v.emplace_back(40, 'x');
+        }
+        bench::do_not_optimize(v.data());
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef NVWA_TEST_NEW_TEST_UTIL_H
+#define NVWA_TEST_NEW_TEST_UTIL_H
+
+// Helpers for the tests of debug_new and memory_trace.  The header of
+// either shall be included first.
+
+#include <stdio.h>              // FILE/tmpfile/fread
+#include <string>               // std::string
+
+#if !defined(NVWA_DEBUG_NEW_H) && !defined(NVWA_MEMORY_TRACE_H)
+#error "Include debug_new.h or memory_trace.h before new_test_util.h"
+#endif
+
+namespace new_test {
+
+// Memory held by the test framework would be reported on exit
+struct disable_autocheck {
+    disable_autocheck()
+    {
+        nvwa::new_autocheck_flag = false;
+#ifdef NVWA_MEMORY_TRACE_H
+        nvwa::new_profile_report_flag = false;
+#endif
+    }
+};
+
+// Redirects the output of the memory tracker to a temporary file
+struct output_capture {
+    output_capture() : fp(tmpfile()), saved_fp(nvwa::new_output_fp)
+    {
+        if (fp != nullptr) {
+            nvwa::new_output_fp = fp;
+        }
+    }
+    ~output_capture()
+    {
+        nvwa::new_output_fp = saved_fp;
+        if (fp != nullptr) {
+            fclose(fp);
+        }
+    }
+    output_capture(const output_capture&) = delete;
+    output_capture& operator=(const output_capture&) = delete;
+
+    std::string str()
+    {
+        std::string result;
+        if (fp == nullptr) {
+            return result;
+        }
+        fflush(fp);
+        rewind(fp);
+        char buffer[256];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof buffer, fp)) > 0) {
+            result.append(buffer, len);
+        }
+        return result;
+    }
+
+    FILE* fp;
+    FILE* saved_fp;
+};
+
+} // namespace new_test
+
+#endif // NVWA_TEST_NEW_TEST_UTIL_H
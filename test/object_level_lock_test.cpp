@@ -0,0 +1,83 @@
+#include "nvwa/object_level_lock.h"
+#include <stdint.h>
+#include <set>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "nvwa/spin_mutex.h"
+
+using namespace boost::unit_test_framework;
+
+namespace {
+
+struct striped_counter
+    : nvwa::striped_object_level_lock<striped_counter> {
+    int value = 0;
+};
+
+struct spin_counter
+    : nvwa::object_level_lock<spin_counter, nvwa::spin_mutex> {
+    int value = 0;
+};
+
+template <typename _Counter>
+void increment_concurrently(std::vector<_Counter>& counters)
+{
+    const int thread_cnt = 4;
+    const int loop_cnt = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_cnt; ++i) {
+        threads.emplace_back([&counters] {
+            for (int j = 0; j < loop_cnt; ++j) {
+                _Counter& counter = counters[j % counters.size()];
+                typename _Counter::lock guard(counter);
+                ++counter.value;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    int total = 0;
+    for (auto& counter : counters) {
+        total += counter.value;
+    }
+    BOOST_CHECK_EQUAL(total, thread_cnt * loop_cnt);
+}
+
+} // unnamed namespace
+
+BOOST_AUTO_TEST_CASE(striped_object_level_lock_test)
+{
+    BOOST_CHECK_EQUAL(sizeof(striped_counter), sizeof(int));
+    std::vector<striped_counter> counters(1000);
+    increment_concurrently(counters);
+}
+
+BOOST_AUTO_TEST_CASE(striped_object_level_lock_spread_test)
+{
+    // Page-aligned objects should not pile up on a few stripes
+    const size_t object_cnt = 1024;
+    const uintptr_t stride = 4096;
+    std::vector<char> buffer((object_cnt + 1) * stride);
+    uintptr_t base = (reinterpret_cast<uintptr_t>(buffer.data()) +
+                      stride - 1) & ~(stride - 1);
+    std::set<nvwa::fast_mutex*> stripes_used;
+    for (size_t i = 0; i < object_cnt; ++i) {
+        stripes_used.insert(&nvwa::get_object_lock_stripe(
+            reinterpret_cast<const void*>(base + i * stride)));
+    }
+    BOOST_CHECK_GE(stripes_used.size(), _OBJECT_LEVEL_LOCK_STRIPES * 3 / 4);
+}
+
+BOOST_AUTO_TEST_CASE(spin_mutex_object_level_lock_test)
+{
+    BOOST_CHECK_LE(sizeof(spin_counter), sizeof(int) * 2);
+    std::vector<spin_counter> counters(1000);
+    increment_concurrently(counters);
+
+    nvwa::spin_mutex mtx;
+    BOOST_CHECK(mtx.try_lock());
+    BOOST_CHECK(!mtx.try_lock());
+    mtx.unlock();
+}
@@ -0,0 +1,36 @@
+#include "nvwa/pctimer.h"
+#include <chrono>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+using namespace boost::unit_test_framework;
+
+BOOST_AUTO_TEST_CASE(pctimer_ns_test)
+{
+    nvwa::pctimer_ns_t t1 = nvwa::pctimer_ns();
+    nvwa::pctimer_ns_t t2 = nvwa::pctimer_ns();
+    BOOST_CHECK_LE(t1, t2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    nvwa::pctimer_ns_t elapsed = nvwa::pctimer_ns() - t2;
+    BOOST_CHECK_GE(elapsed, 20000000U);
+    BOOST_CHECK_LT(elapsed, 2000000000U);
+}
+
+BOOST_AUTO_TEST_CASE(pctimer_ticks_test)
+{
+    BOOST_CHECK_GE(nvwa::pctimer_tick_ns(), 0.0);
+    nvwa::pctimer_ns_t t1 = nvwa::pctimer_ns();
+    nvwa::pctimer_ticks_t ticks1 = nvwa::pctimer_ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    nvwa::pctimer_ticks_t ticks2 = nvwa::pctimer_ticks();
+    nvwa::pctimer_ns_t t2 = nvwa::pctimer_ns();
+    BOOST_CHECK_LE(ticks1, ticks2);
+
+    // The converted ticks should agree with pctimer_ns within 10%
+    double ticks_ns =
+        static_cast<double>(nvwa::pctimer_ticks_to_ns(ticks2 - ticks1));
+    double ns = static_cast<double>(t2 - t1);
+    BOOST_CHECK_GT(ticks_ns, ns * 0.9);
+    BOOST_CHECK_LT(ticks_ns, ns * 1.1);
+}
@@ -0,0 +1,49 @@
+#include "nvwa/split.h"
+#include <stddef.h>
+#include <string_view>
+#include "bench.h"
+
+namespace {
+
+constexpr std::string_view query{
+    "&grant_type=client_credential&appid=wx1234567890abcdef"
+    "&secret=APPSECRET&scope=snsapi_userinfo&state=STATE"};
+
+} // unnamed namespace
+
+// An operation is splitting the whole query string.  It is hidden from
+// the optimizer on each iteration, so that no splitting is done at
+// compile time or hoisted out of the loop.
+
+NVWA_BENCHMARK(split_lazy_iterate)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string_view input = query;
+        bench::do_not_optimize(input);
+        size_t total = 0;
+        for (auto part : nvwa::split(input, '&')) {
+            total += part.size();
+        }
+        bench::do_not_optimize(total);
+    }
+}
+
+NVWA_BENCHMARK(split_to_vector_sv)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string_view input = query;
+        bench::do_not_optimize(input);
+        auto parts = nvwa::split(input, '&').to_vector_sv();
+        bench::do_not_optimize(parts.data());
+    }
+}
+
+NVWA_BENCHMARK(split_to_vector)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string_view input = query;
+        bench::do_not_optimize(input);
+        auto parts = nvwa::split(input, '&').to_vector();
+        bench::do_not_optimize(parts.data());
+    }
+}
@@ -0,0 +1,290 @@
+#include "nvwa/static_mem_pool.h"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <boost/test/unit_test.hpp>
+#include "nvwa/static_mem_pool_trimmer.h"
+
+using namespace boost::unit_test_framework;
+
+typedef nvwa::static_mem_pool<24> pool_type;
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_slab_test)
+{
+    // More blocks than a slab holds, to force multiple slabs
+    const size_t count = _STATIC_MEM_POOL_SLAB_SIZE / 24 * 3;
+    std::vector<void*> blocks;
+    std::set<void*> unique_blocks;
+    for (size_t i = 0; i < count; ++i) {
+        void* ptr = pool_type::instance().allocate();
+        BOOST_REQUIRE(ptr != nullptr);
+        BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr) % 8, 0U);
+        memset(ptr, 0, 24);
+        blocks.push_back(ptr);
+        unique_blocks.insert(ptr);
+    }
+    BOOST_CHECK_EQUAL(unique_blocks.size(), count);
+
+    // Keep one block alive so that at least one slab stays
+    for (size_t i = 1; i < count; ++i) {
+        pool_type::instance().deallocate(blocks[i]);
+    }
+    {
+        nvwa::static_mem_pool_set& pool_set =
+            nvwa::static_mem_pool_set::instance();
+        nvwa::static_mem_pool_set::lock guard;
+        pool_set.recycle();
+    }
+    memset(blocks[0], 0xFF, 24);
+
+    for (size_t i = 1; i < count; ++i) {
+        blocks[i] = pool_type::instance().allocate();
+        BOOST_REQUIRE(blocks[i] != nullptr);
+        BOOST_CHECK(blocks[i] != blocks[0]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        pool_type::instance().deallocate(blocks[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_concurrent_recycle_test)
+{
+    typedef nvwa::static_mem_pool<56> recycle_pool_type;
+    const size_t count = _STATIC_MEM_POOL_SLAB_SIZE / 56 * 8;
+    std::atomic<bool> done(false);
+    std::atomic<size_t> bad_block_cnt(0);
+    std::thread worker([&] {
+        std::vector<void*> blocks;
+        for (int round = 0; round < 20; ++round) {
+            for (size_t i = 0; i < count; ++i) {
+                void* ptr = recycle_pool_type::instance().allocate();
+                memset(ptr, round, 56);
+                blocks.push_back(ptr);
+            }
+            for (size_t i = 0; i < blocks.size(); ++i) {
+                if (static_cast<unsigned char*>(blocks[i])[55] != round) {
+                    ++bad_block_cnt;
+                }
+                recycle_pool_type::instance().deallocate(blocks[i]);
+            }
+            blocks.clear();
+        }
+        done = true;
+    });
+    while (!done) {
+        recycle_pool_type::instance().recycle();
+    }
+    worker.join();
+    BOOST_CHECK_EQUAL(bad_block_cnt.load(), 0U);
+
+    nvwa::mem_pool_stats stats;
+    recycle_pool_type::instance().recycle();
+    recycle_pool_type::instance().get_stats(stats);
+    BOOST_CHECK_EQUAL(stats.blocks_in_use, 0U);
+    BOOST_CHECK_EQUAL(stats.blocks_free, 0U);
+    BOOST_CHECK_EQUAL(stats.sys_allocs, stats.sys_deallocs);
+}
+
+template <typename _Pool>
+void check_backed_pool()
+{
+    const size_t count = 1000;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < count; ++i) {
+        void* ptr = _Pool::instance().allocate();
+        BOOST_REQUIRE(ptr != nullptr);
+        BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr) % 16, 0U);
+        memset(ptr, 0, 48);
+        blocks.push_back(ptr);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        _Pool::instance().deallocate(blocks[i]);
+    }
+    nvwa::static_mem_pool_set& pool_set =
+        nvwa::static_mem_pool_set::instance();
+    nvwa::static_mem_pool_set::lock guard;
+    pool_set.recycle();
+}
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_backing_test)
+{
+    check_backed_pool<
+        nvwa::static_mem_pool<48, -1, nvwa::huge_page_backing>>();
+    check_backed_pool<
+        nvwa::static_mem_pool<48, -1, nvwa::numa_local_backing>>();
+}
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_stats_test)
+{
+    // A pool of the default group, which has a real lock
+    typedef nvwa::static_mem_pool<40> stats_pool_type;
+    nvwa::mem_pool_stats stats;
+    BOOST_REQUIRE(stats_pool_type::instance().get_stats(stats));
+    BOOST_CHECK_EQUAL(stats.block_size, 40U);
+    BOOST_CHECK_EQUAL(stats.group_id, -1);
+    BOOST_CHECK_EQUAL(stats.blocks_in_use, 0U);
+    size_t lock_cnt = stats.lock_acquisitions;
+    size_t contention_cnt = stats.lock_contentions;
+
+    void* ptr1 = stats_pool_type::instance().allocate();
+    void* ptr2 = stats_pool_type::instance().allocate();
+    stats_pool_type::instance().deallocate(ptr1);
+    stats_pool_type::instance().get_stats(stats);
+    BOOST_CHECK_EQUAL(stats.blocks_in_use, 1U);
+    BOOST_CHECK(stats.blocks_free > 0);
+    BOOST_CHECK_EQUAL(stats.sys_allocs, 1U);
+    // Allocating from the system needs one more locking
+    BOOST_CHECK_EQUAL(stats.lock_acquisitions, lock_cnt + 4);
+    BOOST_CHECK_EQUAL(stats.lock_contentions, contention_cnt);
+    stats_pool_type::instance().deallocate(ptr2);
+
+    // An allocation has to wait while the pool lock is held elsewhere
+    stats_pool_type& pool = stats_pool_type::instance();
+    std::thread blocked;
+    {
+        nvwa::class_level_lock<stats_pool_type>::lock guard;
+        blocked = std::thread([&pool] {
+            pool.deallocate(pool.allocate());
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    blocked.join();
+    stats_pool_type::instance().get_stats(stats);
+    BOOST_CHECK_GE(stats.lock_contentions, contention_cnt + 1);
+
+    // Counters stay consistent when threads compete for the pool
+    const int thread_cnt = 4;
+    const int loop_cnt = 10000;
+    lock_cnt = stats.lock_acquisitions;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_cnt; ++i) {
+        threads.emplace_back([&pool] {
+            for (int j = 0; j < loop_cnt; ++j) {
+                pool.deallocate(pool.allocate());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stats_pool_type::instance().get_stats(stats);
+    BOOST_CHECK_EQUAL(stats.blocks_in_use, 0U);
+    BOOST_CHECK_GE(stats.lock_acquisitions,
+                   lock_cnt + thread_cnt * loop_cnt * 2);
+    BOOST_CHECK_LE(stats.lock_contentions, stats.lock_acquisitions);
+
+    std::vector<nvwa::mem_pool_stats> all_stats;
+    nvwa::static_mem_pool_set::instance().get_stats(all_stats);
+    bool found = false;
+    for (size_t i = 0; i < all_stats.size(); ++i) {
+        if (all_stats[i].block_size == 40 && all_stats[i].group_id == -1) {
+            found = true;
+            BOOST_CHECK_EQUAL(all_stats[i].blocks_in_use, 0U);
+        }
+    }
+    BOOST_CHECK(found);
+
+    std::ostringstream oss;
+    nvwa::static_mem_pool_set::instance().print_stats(oss);
+    BOOST_CHECK(oss.str().find("Contended") != std::string::npos);
+    oss.str("");
+    nvwa::static_mem_pool_set::instance().print_stats(
+        oss, nvwa::static_mem_pool_set::json_format);
+    BOOST_CHECK(oss.str().find("\"block_size\": 40, \"group_id\": -1") !=
+                std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_trimmer_test)
+{
+    typedef nvwa::static_mem_pool<72> trim_pool_type;
+    typedef nvwa::static_mem_pool<72, 5> grouped_pool_type;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 100; ++i) {
+        blocks.push_back(trim_pool_type::instance().allocate());
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        trim_pool_type::instance().deallocate(blocks[i]);
+    }
+    grouped_pool_type::instance().deallocate(
+        grouped_pool_type::instance().allocate());
+    nvwa::mem_pool_stats stats;
+    trim_pool_type::instance().get_stats(stats);
+    BOOST_CHECK(stats.blocks_free > 0);
+    BOOST_CHECK(trim_pool_type::instance().is_thread_safe());
+    BOOST_CHECK(!grouped_pool_type::instance().is_thread_safe());
+
+    std::atomic<size_t> usage(100);
+    nvwa::static_mem_pool_trimmer trimmer(
+        1000, std::chrono::milliseconds(10), [&usage] { return usage.load(); });
+    BOOST_CHECK(!trimmer.trim());
+    usage = 2000;
+    for (int i = 0; i < 200 && trimmer.get_trim_count() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    trimmer.stop();
+    BOOST_CHECK(trimmer.get_trim_count() > 0);
+    trim_pool_type::instance().get_stats(stats);
+    BOOST_CHECK_EQUAL(stats.blocks_free, 0U);
+    BOOST_CHECK_EQUAL(stats.sys_deallocs, 1U);
+
+    // Grouped memory pools are not thread-safe, and are not trimmed
+    grouped_pool_type::instance().get_stats(stats);
+    BOOST_CHECK(stats.blocks_free > 0);
+    BOOST_CHECK_EQUAL(stats.sys_deallocs, 0U);
+
+    BOOST_CHECK(nvwa::static_mem_pool_trimmer::process_rss() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(static_mem_pool_trimmer_rss_test)
+{
+    size_t rss_start = nvwa::static_mem_pool_trimmer::process_rss();
+    if (rss_start == 0) {
+        BOOST_TEST_MESSAGE("Process RSS is unknown; test skipped");
+        return;
+    }
+
+    // Not a size class of static_mem_pool_resource, so that no other
+    // test uses the memory pool
+    const size_t block_size = 88;
+    typedef nvwa::static_mem_pool<block_size> rss_pool_type;
+    const size_t pool_mem = 64 * 1024 * 1024;
+    const size_t slab_blocks = _STATIC_MEM_POOL_SLAB_SIZE / block_size;
+    std::vector<void*> blocks;
+    std::vector<void*> pins;
+    blocks.reserve(pool_mem / block_size);
+    for (size_t i = 0; i < pool_mem / block_size; ++i) {
+        void* ptr = rss_pool_type::instance().allocate();
+        BOOST_REQUIRE(ptr != nullptr);
+        memset(ptr, 0, block_size);
+        blocks.push_back(ptr);
+        // Keep heap memory in use between the slabs, so that freeing
+        // the slabs alone cannot shrink the heap
+        if (i % slab_blocks == 0) {
+            pins.push_back(malloc(1000));
+        }
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        rss_pool_type::instance().deallocate(blocks[i]);
+    }
+    std::vector<void*>().swap(blocks);
+    size_t rss_pooled = nvwa::static_mem_pool_trimmer::process_rss();
+    BOOST_CHECK_GT(rss_pooled, rss_start + pool_mem / 2);
+
+    nvwa::static_mem_pool_trimmer trimmer(
+        rss_start + pool_mem / 4, std::chrono::hours(1));
+    BOOST_CHECK(trimmer.trim());
+    trimmer.stop();
+    size_t rss_trimmed = nvwa::static_mem_pool_trimmer::process_rss();
+    BOOST_CHECK_LT(rss_trimmed, rss_start + pool_mem / 2);
+    for (size_t i = 0; i < pins.size(); ++i) {
+        free(pins[i]);
+    }
+}
@@ -20,6 +20,7 @@ using namespace std;
 int main()
 {
     cout << left;
+    DISPLAY_FEATURE(HAVE_CXX11_ALIGNAS);
     DISPLAY_FEATURE(HAVE_CXX11_ATOMIC);
     DISPLAY_FEATURE(HAVE_CXX11_AUTO_TYPE);
     DISPLAY_FEATURE(HAVE_CXX11_EXPLICIT_CONVERSION);
@@ -40,6 +41,7 @@ int main()
     DISPLAY_FEATURE(HAVE_CXX11_UNICODE_LITERAL);
     DISPLAY_FEATURE(HAVE_CXX17_STRING_VIEW);
     DISPLAY_FEATURE(HAVE_CXX17_ANY);
+    DISPLAY_FEATURE(HAVE_CXX17_MEMORY_RESOURCE);
     DISPLAY_FEATURE(HAVE_CXX17_OPTIONAL);
     DISPLAY_FEATURE(HAVE_CXX17_VARIANT);
 